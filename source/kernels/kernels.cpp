@@ -0,0 +1,77 @@
+#include "kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+struct CpuFeatures {
+    bool sse42{false};
+    bool avx2{false};
+    bool avx512{false};
+};
+
+CpuFeatures DetectCpuFeatures() {
+    CpuFeatures features;
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse42   = (info[2] & (1 << 20)) != 0;
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx     = (info[2] & (1 << 28)) != 0;
+    // 操作系统需要保存 YMM / ZMM 状态
+    uint64_t xcr0  = osxsave ? _xgetbv(0) : 0;
+    bool     ymmOk = (xcr0 & 0x6) == 0x6;
+    bool     zmmOk = (xcr0 & 0xe6) == 0xe6;
+    bool     avx2 = false, avx512 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2   = (info[1] & (1 << 5)) != 0;
+        avx512 = (info[1] & (1 << 16)) && (info[1] & (1 << 17)) && (info[1] & (1 << 30)) &&
+                 (info[1] & (1 << 31));
+    }
+    features.sse42  = sse42;
+    features.avx2   = avx && avx2 && fma && ymmOk;
+    features.avx512 = features.avx2 && avx512 && zmmOk;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    // __builtin_cpu_supports 已经检查了操作系统对 AVX 状态的支持
+    __builtin_cpu_init();
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+    features.avx2  = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    features.avx512 = features.avx2 && __builtin_cpu_supports("avx512f") &&
+                      __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq") &&
+                      __builtin_cpu_supports("avx512vl");
+#endif
+    return features;
+}
+
+const KernelTable* SelectKernels() {
+    CpuFeatures features = DetectCpuFeatures();
+    KernelPath  limit    = KernelPath::AVX512;
+    if (const char* env = std::getenv("SR_KERNEL_PATH")) {
+        if (strcmp(env, "scalar") == 0) limit = KernelPath::Scalar;
+        else if (strcmp(env, "sse4.2") == 0) limit = KernelPath::SSE42;
+        else if (strcmp(env, "avx2") == 0) limit = KernelPath::AVX2;
+    }
+
+    const KernelTable* table = nullptr;
+    if (features.avx512 && limit >= KernelPath::AVX512) table = GetAVX512Kernels();
+    if (!table && features.avx2 && limit >= KernelPath::AVX2) table = GetAVX2Kernels();
+    if (!table && features.sse42 && limit >= KernelPath::SSE42) table = GetSSE42Kernels();
+    if (!table) table = GetScalarKernels();
+    return table;
+}
+
+} // namespace
+
+const KernelTable& GetKernels() {
+    static const KernelTable* table = SelectKernels();
+    return *table;
+}
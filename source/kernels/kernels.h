@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+// 热点内核按指令集分别编译（kernels_*.cpp），启动时根据 CPUID 选择一次
+// 所有版本的结果逐位相同，只是每次处理的像素/顶点数不同
+enum class KernelPath { Scalar, SSE42, AVX2, AVX512 };
+
+// HDR 颜色解析时的色调映射曲线
+enum class ToneMapping : uint8_t {
+    Linear,   // 只乘曝光，超过 1 的部分直接截断
+    Reinhard, // x / (1 + x)
+    ACES,     // ACES filmic 拟合曲线
+};
+
+struct KernelTable {
+    KernelPath  path;
+    const char* name;
+
+    // 一行像素的边函数覆盖测试：E_k(i) = e[k] + step[k] * i，三条边都满足 E_k >= bias[k] 时覆盖
+    // mask[i] 写 0/1，返回覆盖的像素数
+    int (*edgeCoverage)(const int32_t e[3], const int32_t step[3], const int32_t bias[3],
+                        int count, uint8_t* mask);
+
+    // 一行像素 (x0 + i + 0.5, y + 0.5) 的 1/w 与重心权重，perspective 为 false 时输出屏幕空间权重
+    // sx/sy 是三个顶点的屏幕坐标，rhw 是三个顶点的 1/w；三角形面积为 0 的像素从 mask 中去掉
+    void (*barycentricSpan)(const float sx[3], const float sy[3], const float rhw[3], int x0,
+                            int y, int count, uint8_t* mask, float* outRhw, float* outW0,
+                            float* outW1, float* outW2, bool perspective);
+
+    // out[i] = a[i] * w0 + b[i] * w1 + c[i] * w2
+    void (*interpolate)(const float* a, const float* b, const float* c, float w0, float w1,
+                        float w2, int count, float* out);
+
+    // 四个 0xAARRGGBB 纹素按 8 位定点权重 (dx, dy) 双线性混合
+    uint32_t (*bilinearFilter)(uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br, int32_t dx,
+                               int32_t dy);
+
+    // rgba 浮点钳制到 [0, 1] 后打包成 0xAARRGGBB
+    void (*packColors)(const float* rgba, int count, uint32_t* out);
+
+    // HDR rgba 乘以曝光、按 mode 做色调映射（alpha 不变）后打包成 0xAARRGGBB
+    void (*resolveColors)(const float* rgba, int count, float exposure, ToneMapping mode,
+                          uint32_t* out);
+
+    // 位置按 (x, y, z, 1) * m 变换到裁剪空间，同时输出 1/w 和 ClipCode
+    void (*transformPositions)(const float* x, const float* y, const float* z, int count,
+                               const float m[4][4], float* outX, float* outY, float* outZ,
+                               float* outW, float* outRhw, uint8_t* outcode);
+
+    // 同一组位置按 instances 个矩阵分别变换，每个顶点只读取一次
+    // 第 k 个实例的结果写在 out*[k * count, (k + 1) * count)
+    void (*transformInstances)(const float* x, const float* y, const float* z, int count,
+                               const float (*m)[4][4], int instances, float* outX, float* outY,
+                               float* outZ, float* outW, float* outRhw, uint8_t* outcode);
+
+    // 法线按 n * m 变换并重新归一化
+    void (*transformNormals)(const float* x, const float* y, const float* z, int count,
+                             const float m[3][3], float* outX, float* outY, float* outZ);
+};
+
+// 当前 CPU 可用的最快版本，环境变量 SR_KERNEL_PATH=scalar/sse4.2/avx2/avx512 可以限制上限
+const KernelTable& GetKernels();
+
+// 各指令集版本，不支持的平台返回 nullptr
+const KernelTable* GetScalarKernels();
+const KernelTable* GetSSE42Kernels();
+const KernelTable* GetAVX2Kernels();
+const KernelTable* GetAVX512Kernels();
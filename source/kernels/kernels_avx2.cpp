@@ -0,0 +1,13 @@
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNEL_NAMESPACE kernels_avx2
+#define KERNEL_ISA_AVX2
+#define KERNEL_PATH KernelPath::AVX2
+#define KERNEL_NAME "avx2"
+#include "kernels_impl.h"
+
+const KernelTable* GetAVX2Kernels() { return kernels_avx2::GetTable(); }
+#else
+const KernelTable* GetAVX2Kernels() { return nullptr; }
+#endif
@@ -0,0 +1,13 @@
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNEL_NAMESPACE kernels_avx512
+#define KERNEL_ISA_AVX512
+#define KERNEL_PATH KernelPath::AVX512
+#define KERNEL_NAME "avx512"
+#include "kernels_impl.h"
+
+const KernelTable* GetAVX512Kernels() { return kernels_avx512::GetTable(); }
+#else
+const KernelTable* GetAVX512Kernels() { return nullptr; }
+#endif
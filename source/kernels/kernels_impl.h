@@ -0,0 +1,536 @@
+// 内核的通用实现，由 kernels_<isa>.cpp 定义 KERNEL_NAMESPACE 和 KERNEL_ISA_* 之后包含
+// 同一份代码按不同指令集编译多次，因此这里只能使用 intrinsics 和本命名空间内的函数：
+// 调用 math.h 等头文件里的 inline 函数会生成按高指令集编译的副本，链接器可能把它交给所有调用者
+// 这些文件都用 -ffp-contract=off 编译，乘加不会被合并成 FMA，各版本结果逐位相同
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "kernels.h"
+
+#if !defined(KERNEL_ISA_SCALAR)
+#include <immintrin.h>
+#endif
+
+namespace KERNEL_NAMESPACE {
+
+//---------------------------------------------------------------------
+// 按指令集选择的向量类型，vmask 是比较结果
+//---------------------------------------------------------------------
+#if defined(KERNEL_ISA_AVX512)
+constexpr int LANES = 16;
+using vfloat        = __m512;
+using vint          = __m512i;
+using vmask         = __mmask16;
+
+inline vfloat   vf_set1(float x) { return _mm512_set1_ps(x); }
+inline vfloat   vf_load(const float* p) { return _mm512_loadu_ps(p); }
+inline void     vf_store(float* p, vfloat v) { _mm512_storeu_ps(p, v); }
+inline vfloat   vf_add(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+inline vfloat   vf_sub(vfloat a, vfloat b) { return _mm512_sub_ps(a, b); }
+inline vfloat   vf_mul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+inline vfloat   vf_div(vfloat a, vfloat b) { return _mm512_div_ps(a, b); }
+inline vfloat   vf_sqrt(vfloat a) { return _mm512_sqrt_ps(a); }
+inline vfloat   vf_abs(vfloat a) { return _mm512_andnot_ps(_mm512_set1_ps(-0.0f), a); }
+inline vfloat   vf_select(vmask m, vfloat a, vfloat b) { return _mm512_mask_blend_ps(m, b, a); }
+inline vmask    vf_eq(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+inline vmask    vf_neq(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+inline vmask    vf_lt(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+inline vmask    vf_gt(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+inline vfloat   vf_iota() {
+    return _mm512_setr_ps(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+inline vint     vi_set1(int32_t x) { return _mm512_set1_epi32(x); }
+inline vint     vi_add(vint a, vint b) { return _mm512_add_epi32(a, b); }
+inline vint     vi_mul(vint a, vint b) { return _mm512_mullo_epi32(a, b); }
+inline vmask    vi_gt(vint a, vint b) { return _mm512_cmpgt_epi32_mask(a, b); }
+inline vint     vi_iota() {
+    return _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+inline vmask    vm_and(vmask a, vmask b) { return (vmask)(a & b); }
+inline uint32_t vm_bits(vmask m) { return (uint32_t)m; }
+
+#elif defined(KERNEL_ISA_AVX2)
+constexpr int LANES = 8;
+using vfloat        = __m256;
+using vint          = __m256i;
+using vmask         = __m256;
+
+inline vfloat   vf_set1(float x) { return _mm256_set1_ps(x); }
+inline vfloat   vf_load(const float* p) { return _mm256_loadu_ps(p); }
+inline void     vf_store(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+inline vfloat   vf_add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+inline vfloat   vf_sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+inline vfloat   vf_mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+inline vfloat   vf_div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+inline vfloat   vf_sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+inline vfloat   vf_abs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline vfloat   vf_select(vmask m, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, m); }
+inline vmask    vf_eq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+inline vmask    vf_neq(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+inline vmask    vf_lt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline vmask    vf_gt(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline vfloat   vf_iota() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+inline vint     vi_set1(int32_t x) { return _mm256_set1_epi32(x); }
+inline vint     vi_add(vint a, vint b) { return _mm256_add_epi32(a, b); }
+inline vint     vi_mul(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+inline vmask    vi_gt(vint a, vint b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(a, b)); }
+inline vint     vi_iota() { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+inline vmask    vm_and(vmask a, vmask b) { return _mm256_and_ps(a, b); }
+inline uint32_t vm_bits(vmask m) { return (uint32_t)_mm256_movemask_ps(m); }
+
+#elif defined(KERNEL_ISA_SSE42)
+constexpr int LANES = 4;
+using vfloat        = __m128;
+using vint          = __m128i;
+using vmask         = __m128;
+
+inline vfloat   vf_set1(float x) { return _mm_set1_ps(x); }
+inline vfloat   vf_load(const float* p) { return _mm_loadu_ps(p); }
+inline void     vf_store(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+inline vfloat   vf_add(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+inline vfloat   vf_sub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+inline vfloat   vf_mul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+inline vfloat   vf_div(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+inline vfloat   vf_sqrt(vfloat a) { return _mm_sqrt_ps(a); }
+inline vfloat   vf_abs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline vfloat   vf_select(vmask m, vfloat a, vfloat b) { return _mm_blendv_ps(b, a, m); }
+inline vmask    vf_eq(vfloat a, vfloat b) { return _mm_cmpeq_ps(a, b); }
+inline vmask    vf_neq(vfloat a, vfloat b) { return _mm_cmpneq_ps(a, b); }
+inline vmask    vf_lt(vfloat a, vfloat b) { return _mm_cmplt_ps(a, b); }
+inline vmask    vf_gt(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+inline vfloat   vf_iota() { return _mm_setr_ps(0, 1, 2, 3); }
+inline vint     vi_set1(int32_t x) { return _mm_set1_epi32(x); }
+inline vint     vi_add(vint a, vint b) { return _mm_add_epi32(a, b); }
+inline vint     vi_mul(vint a, vint b) { return _mm_mullo_epi32(a, b); }
+inline vmask    vi_gt(vint a, vint b) { return _mm_castsi128_ps(_mm_cmpgt_epi32(a, b)); }
+inline vint     vi_iota() { return _mm_setr_epi32(0, 1, 2, 3); }
+inline vmask    vm_and(vmask a, vmask b) { return _mm_and_ps(a, b); }
+inline uint32_t vm_bits(vmask m) { return (uint32_t)_mm_movemask_ps(m); }
+
+#else
+constexpr int LANES = 1;
+using vfloat        = float;
+using vint          = int32_t;
+using vmask         = bool;
+
+inline vfloat   vf_set1(float x) { return x; }
+inline vfloat   vf_load(const float* p) { return *p; }
+inline void     vf_store(float* p, vfloat v) { *p = v; }
+inline vfloat   vf_add(vfloat a, vfloat b) { return a + b; }
+inline vfloat   vf_sub(vfloat a, vfloat b) { return a - b; }
+inline vfloat   vf_mul(vfloat a, vfloat b) { return a * b; }
+inline vfloat   vf_div(vfloat a, vfloat b) { return a / b; }
+inline vfloat   vf_sqrt(vfloat a) { return sqrtf(a); }
+inline vfloat   vf_abs(vfloat a) { return (a < 0) ? -a : a; }
+inline vfloat   vf_select(vmask m, vfloat a, vfloat b) { return m ? a : b; }
+inline vmask    vf_eq(vfloat a, vfloat b) { return a == b; }
+inline vmask    vf_neq(vfloat a, vfloat b) { return a != b; }
+inline vmask    vf_lt(vfloat a, vfloat b) { return a < b; }
+inline vmask    vf_gt(vfloat a, vfloat b) { return a > b; }
+inline vfloat   vf_iota() { return 0.0f; }
+inline vint     vi_set1(int32_t x) { return x; }
+inline vint     vi_add(vint a, vint b) { return a + b; }
+inline vint     vi_mul(vint a, vint b) { return a * b; }
+inline vmask    vi_gt(vint a, vint b) { return a > b; }
+inline vint     vi_iota() { return 0; }
+inline vmask    vm_and(vmask a, vmask b) { return a && b; }
+inline uint32_t vm_bits(vmask m) { return m ? 1u : 0u; }
+#endif
+
+inline float ScalarAbs(float a) { return (a < 0) ? -a : a; }
+
+//---------------------------------------------------------------------
+// 光栅化
+//---------------------------------------------------------------------
+int EdgeCoverage(const int32_t e[3], const int32_t step[3], const int32_t bias[3], int count,
+                 uint8_t* mask) {
+    vint E[3], D[3], B[3];
+    for (int k = 0; k < 3; k++) {
+        E[k] = vi_add(vi_set1(e[k]), vi_mul(vi_iota(), vi_set1(step[k])));
+        D[k] = vi_set1(step[k] * LANES);
+        B[k] = vi_set1(bias[k] - 1);
+    }
+    int covered = 0, i = 0;
+    for (; i + LANES <= count; i += LANES) {
+        vmask    inside = vm_and(vm_and(vi_gt(E[0], B[0]), vi_gt(E[1], B[1])), vi_gt(E[2], B[2]));
+        uint32_t bits   = vm_bits(inside);
+        for (int j = 0; j < LANES; j++) {
+            mask[i + j] = (bits >> j) & 1;
+            covered += mask[i + j];
+        }
+        for (int k = 0; k < 3; k++)
+            E[k] = vi_add(E[k], D[k]);
+    }
+    for (; i < count; i++) {
+        bool inside = true;
+        for (int k = 0; k < 3; k++)
+            inside &= e[k] + step[k] * i >= bias[k];
+        mask[i] = inside;
+        covered += inside;
+    }
+    return covered;
+}
+
+// 与逐像素的重心坐标计算保持相同的运算顺序
+void BarycentricSpan(const float sx[3], const float sy[3], const float rhw[3], int x0, int y,
+                     int count, uint8_t* mask, float* outRhw, float* outW0, float* outW1,
+                     float* outW2, bool perspective) {
+    float py = (float)y + 0.5f;
+    int   i  = 0;
+    if (LANES > 1) {
+        vfloat X[3], Y[3], R[3];
+        for (int k = 0; k < 3; k++) {
+            X[k] = vf_set1(sx[k]);
+            Y[k] = vf_set1(sy[k] - py);
+            R[k] = vf_set1(rhw[k]);
+        }
+        vfloat zero = vf_set1(0.0f), one = vf_set1(1.0f), half = vf_set1(0.5f);
+        for (; i + LANES <= count; i += LANES) {
+            vfloat px = vf_add(vf_add(vf_set1((float)(x0 + i)), vf_iota()), half);
+            vfloat s0 = vf_sub(X[0], px), s1 = vf_sub(X[1], px), s2 = vf_sub(X[2], px);
+            vfloat a  = vf_abs(vf_sub(vf_mul(s1, Y[2]), vf_mul(Y[1], s2)));
+            vfloat b  = vf_abs(vf_sub(vf_mul(s2, Y[0]), vf_mul(Y[2], s0)));
+            vfloat c  = vf_abs(vf_sub(vf_mul(s0, Y[1]), vf_mul(Y[0], s1)));
+            vfloat s  = vf_add(vf_add(a, b), c);
+            uint32_t valid = vm_bits(vf_neq(s, zero));
+            vfloat   inv   = vf_div(one, s);
+            a              = vf_mul(a, inv);
+            b              = vf_mul(b, inv);
+            c              = vf_mul(c, inv);
+            vfloat r = vf_add(vf_add(vf_mul(R[0], a), vf_mul(R[1], b)), vf_mul(R[2], c));
+            vf_store(outRhw + i, r);
+            if (perspective) {
+                vfloat w = vf_div(one, vf_select(vf_neq(r, zero), r, one));
+                a        = vf_mul(vf_mul(R[0], a), w);
+                b        = vf_mul(vf_mul(R[1], b), w);
+                c        = vf_mul(vf_mul(R[2], c), w);
+            }
+            vf_store(outW0 + i, a);
+            vf_store(outW1 + i, b);
+            vf_store(outW2 + i, c);
+            for (int j = 0; j < LANES; j++)
+                mask[i + j] &= (valid >> j) & 1;
+        }
+    }
+    for (; i < count; i++) {
+        float px = (float)(x0 + i) + 0.5f;
+        float s0 = sx[0] - px, s1 = sx[1] - px, s2 = sx[2] - px;
+        float t0 = sy[0] - py, t1 = sy[1] - py, t2 = sy[2] - py;
+        float a  = ScalarAbs(s1 * t2 - t1 * s2);
+        float b  = ScalarAbs(s2 * t0 - t2 * s0);
+        float c  = ScalarAbs(s0 * t1 - t0 * s1);
+        float s  = a + b + c;
+        if (s == 0.0f) mask[i] = 0;
+        a        = a * (1.0f / s);
+        b        = b * (1.0f / s);
+        c        = c * (1.0f / s);
+        float r  = rhw[0] * a + rhw[1] * b + rhw[2] * c;
+        outRhw[i] = r;
+        if (perspective) {
+            float w = 1.0f / ((r != 0.0f) ? r : 1.0f);
+            a       = rhw[0] * a * w;
+            b       = rhw[1] * b * w;
+            c       = rhw[2] * c * w;
+        }
+        outW0[i] = a;
+        outW1[i] = b;
+        outW2[i] = c;
+    }
+}
+
+void Interpolate(const float* a, const float* b, const float* c, float w0, float w1, float w2,
+                 int count, float* out) {
+    int i = 0;
+    if (LANES > 1) {
+        vfloat W0 = vf_set1(w0), W1 = vf_set1(w1), W2 = vf_set1(w2);
+        for (; i + LANES <= count; i += LANES) {
+            vfloat v = vf_add(vf_mul(vf_load(a + i), W0), vf_mul(vf_load(b + i), W1));
+            vf_store(out + i, vf_add(v, vf_mul(vf_load(c + i), W2)));
+        }
+    }
+    for (; i < count; i++)
+        out[i] = a[i] * w0 + b[i] * w1 + c[i] * w2;
+}
+
+//---------------------------------------------------------------------
+// 纹理与颜色：四个通道放在 128 位寄存器的四个 32 位通道里
+//---------------------------------------------------------------------
+uint32_t BilinearFilter(uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br, int32_t distx,
+                        int32_t disty) {
+    int32_t distxy   = distx * disty;
+    int32_t distxiy  = (distx << 8) - distxy; /* distx * (256 - disty) */
+    int32_t distixy  = (disty << 8) - distxy; /* disty * (256 - distx) */
+    int32_t distixiy = 256 * 256 - (disty << 8) - (distx << 8) + distxy;
+#if defined(KERNEL_ISA_SCALAR)
+    // 每个通道 = (四个纹素按权重求和) >> 16
+    uint32_t r = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t sum = ((tl >> shift) & 0xff) * distixiy + ((tr >> shift) & 0xff) * distxiy +
+                       ((bl >> shift) & 0xff) * distixy + ((br >> shift) & 0xff) * distxy;
+        r |= (sum >> 16) << shift;
+    }
+    return r;
+#else
+    __m128i sum = _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)tl)),
+                                  _mm_set1_epi32(distixiy));
+    sum         = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)tr)),
+                                                     _mm_set1_epi32(distxiy)));
+    sum         = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)bl)),
+                                                     _mm_set1_epi32(distixy)));
+    sum         = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)br)),
+                                                     _mm_set1_epi32(distxy)));
+    sum         = _mm_srli_epi32(sum, 16);
+    sum         = _mm_packus_epi32(sum, sum);
+    return (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#endif
+}
+
+void PackColors(const float* rgba, int count, uint32_t* out) {
+    int i = 0;
+#if !defined(KERNEL_ISA_SCALAR)
+    __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+    auto   convert = [&](const float* p) {
+        __m128  v  = _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(p)));
+        __m128i iv = _mm_cvttps_epi32(_mm_mul_ps(v, scale));
+        // (r, g, b, a) -> (b, g, r, a)，小端存储正好是 0xAARRGGBB
+        return _mm_shuffle_epi32(iv, _MM_SHUFFLE(3, 0, 1, 2));
+    };
+    for (; i + 4 <= count; i += 4) {
+        __m128i lo = _mm_packus_epi32(convert(rgba + i * 4), convert(rgba + i * 4 + 4));
+        __m128i hi = _mm_packus_epi32(convert(rgba + i * 4 + 8), convert(rgba + i * 4 + 12));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t c[4];
+        for (int k = 0; k < 4; k++) {
+            float x = rgba[i * 4 + k];
+            x       = (x < 0.0f) ? 0.0f : x;
+            x       = (x > 1.0f) ? 1.0f : x;
+            c[k]    = (int32_t)(x * 255.0f);
+        }
+        out[i] = ((uint32_t)c[3] << 24) + ((uint32_t)c[0] << 16) + ((uint32_t)c[1] << 8) +
+                 (uint32_t)c[2];
+    }
+}
+
+// 每 4 个 float 中的第 4 个是 alpha
+alignas(64) static const float ALPHA_LANES[16] = {0, 0, 0, 1, 0, 0, 0, 1,
+                                                  0, 0, 0, 1, 0, 0, 0, 1};
+
+template <ToneMapping Mode> inline vfloat ToneCurve(vfloat x) {
+    if constexpr (Mode == ToneMapping::Reinhard) {
+        return vf_div(x, vf_add(x, vf_set1(1.0f)));
+    } else if constexpr (Mode == ToneMapping::ACES) {
+        vfloat num = vf_mul(x, vf_add(vf_mul(x, vf_set1(2.51f)), vf_set1(0.03f)));
+        vfloat den = vf_add(vf_mul(x, vf_add(vf_mul(x, vf_set1(2.43f)), vf_set1(0.59f))),
+                            vf_set1(0.14f));
+        return vf_div(num, den);
+    } else {
+        return x;
+    }
+}
+
+template <ToneMapping Mode> inline float ToneCurveScalar(float x) {
+    if constexpr (Mode == ToneMapping::Reinhard) {
+        return x / (x + 1.0f);
+    } else if constexpr (Mode == ToneMapping::ACES) {
+        return (x * (x * 2.51f + 0.03f)) / (x * (x * 2.43f + 0.59f) + 0.14f);
+    } else {
+        return x;
+    }
+}
+
+// 分块映射到栈上的缓冲区再打包，整行数据只读一遍
+template <ToneMapping Mode>
+void ResolveColorsWith(const float* rgba, int count, float exposure, uint32_t* out) {
+    constexpr int CHUNK = 64;
+    alignas(64) float mapped[CHUNK * 4];
+    for (int base = 0; base < count; base += CHUNK) {
+        int          n      = (count - base < CHUNK) ? count - base : CHUNK;
+        int          floats = n * 4;
+        const float* src    = rgba + base * 4;
+        int          i      = 0;
+        if (LANES >= 4) {
+            vmask  alpha = vf_gt(vf_load(ALPHA_LANES), vf_set1(0.0f));
+            vfloat scale = vf_set1(exposure);
+            for (; i + LANES <= floats; i += LANES) {
+                vfloat v = vf_load(src + i);
+                vf_store(mapped + i, vf_select(alpha, v, ToneCurve<Mode>(vf_mul(v, scale))));
+            }
+        }
+        for (; i < floats; i++)
+            mapped[i] = (i % 4 == 3) ? src[i] : ToneCurveScalar<Mode>(src[i] * exposure);
+        PackColors(mapped, n, out + base);
+    }
+}
+
+void ResolveColors(const float* rgba, int count, float exposure, ToneMapping mode,
+                   uint32_t* out) {
+    switch (mode) {
+    case ToneMapping::Reinhard:
+        ResolveColorsWith<ToneMapping::Reinhard>(rgba, count, exposure, out);
+        break;
+    case ToneMapping::ACES:
+        ResolveColorsWith<ToneMapping::ACES>(rgba, count, exposure, out);
+        break;
+    default:
+        ResolveColorsWith<ToneMapping::Linear>(rgba, count, exposure, out);
+        break;
+    }
+}
+
+//---------------------------------------------------------------------
+// 批量顶点变换，乘加顺序和 Vec4f * Mat4x4f 相同
+//---------------------------------------------------------------------
+uint8_t ClipOutcode(float x, float y, float z, float w) {
+    uint8_t code = 0;
+    code |= (x < -w) ? 1 << 0 : 0;
+    code |= (x > w) ? 1 << 1 : 0;
+    code |= (y < -w) ? 1 << 2 : 0;
+    code |= (y > w) ? 1 << 3 : 0;
+    code |= (z < 0.0f) ? 1 << 4 : 0;
+    code |= (z > w) ? 1 << 5 : 0;
+    code |= (w == 0.0f) ? 1 << 6 : 0;
+    return code;
+}
+
+// 一组顶点 (x, y, z, 1) * m，结果写到 out*[i] 开始的位置
+inline void TransformLanes(vfloat vx, vfloat vy, vfloat vz, const vfloat M[4][4], int i,
+                           float* outX, float* outY, float* outZ, float* outW, float* outRhw,
+                           uint8_t* outcode) {
+    vfloat zero = vf_set1(0.0f), one = vf_set1(1.0f);
+    vfloat p[4];
+    for (int c = 0; c < 4; c++) {
+        vfloat t = vf_add(vf_mul(vx, M[0][c]), vf_mul(vy, M[1][c]));
+        p[c]     = vf_add(vf_add(t, vf_mul(vz, M[2][c])), M[3][c]);
+    }
+    vf_store(outX + i, p[0]);
+    vf_store(outY + i, p[1]);
+    vf_store(outZ + i, p[2]);
+    vf_store(outW + i, p[3]);
+    vf_store(outRhw + i, vf_div(one, p[3]));
+    vfloat   nw      = vf_sub(zero, p[3]);
+    uint32_t bits[7] = {
+        vm_bits(vf_lt(p[0], nw)), vm_bits(vf_gt(p[0], p[3])), vm_bits(vf_lt(p[1], nw)),
+        vm_bits(vf_gt(p[1], p[3])), vm_bits(vf_lt(p[2], zero)),
+        vm_bits(vf_gt(p[2], p[3])), vm_bits(vf_eq(p[3], zero)),
+    };
+    for (int j = 0; j < LANES; j++) {
+        uint8_t code = 0;
+        for (int k = 0; k < 7; k++)
+            code |= ((bits[k] >> j) & 1) << k;
+        outcode[i + j] = code;
+    }
+}
+
+inline void TransformScalar(float x, float y, float z, const float m[4][4], int i, float* outX,
+                            float* outY, float* outZ, float* outW, float* outRhw,
+                            uint8_t* outcode) {
+    float p[4];
+    for (int c = 0; c < 4; c++)
+        p[c] = x * m[0][c] + y * m[1][c] + z * m[2][c] + m[3][c];
+    outX[i]    = p[0];
+    outY[i]    = p[1];
+    outZ[i]    = p[2];
+    outW[i]    = p[3];
+    outRhw[i]  = 1.0f / p[3];
+    outcode[i] = ClipOutcode(p[0], p[1], p[2], p[3]);
+}
+
+void TransformPositions(const float* x, const float* y, const float* z, int count,
+                        const float m[4][4], float* outX, float* outY, float* outZ, float* outW,
+                        float* outRhw, uint8_t* outcode) {
+    int i = 0;
+    if (LANES > 1) {
+        vfloat M[4][4];
+        for (int r = 0; r < 4; r++) {
+            for (int c = 0; c < 4; c++)
+                M[r][c] = vf_set1(m[r][c]);
+        }
+        for (; i + LANES <= count; i += LANES)
+            TransformLanes(vf_load(x + i), vf_load(y + i), vf_load(z + i), M, i, outX, outY, outZ,
+                           outW, outRhw, outcode);
+    }
+    for (; i < count; i++)
+        TransformScalar(x[i], y[i], z[i], m, i, outX, outY, outZ, outW, outRhw, outcode);
+}
+
+// 顶点按块读取一次，依次乘上每个实例的矩阵；矩阵放不进寄存器，每块重新广播
+void TransformInstances(const float* x, const float* y, const float* z, int count,
+                        const float (*m)[4][4], int instances, float* outX, float* outY,
+                        float* outZ, float* outW, float* outRhw, uint8_t* outcode) {
+    int i = 0;
+    if (LANES > 1) {
+        for (; i + LANES <= count; i += LANES) {
+            vfloat vx = vf_load(x + i), vy = vf_load(y + i), vz = vf_load(z + i);
+            for (int k = 0; k < instances; k++) {
+                vfloat M[4][4];
+                for (int r = 0; r < 4; r++) {
+                    for (int c = 0; c < 4; c++)
+                        M[r][c] = vf_set1(m[k][r][c]);
+                }
+                size_t base = (size_t)k * count;
+                TransformLanes(vx, vy, vz, M, i, outX + base, outY + base, outZ + base,
+                               outW + base, outRhw + base, outcode + base);
+            }
+        }
+    }
+    for (; i < count; i++) {
+        for (int k = 0; k < instances; k++) {
+            size_t base = (size_t)k * count;
+            TransformScalar(x[i], y[i], z[i], m[k], i, outX + base, outY + base, outZ + base,
+                            outW + base, outRhw + base, outcode + base);
+        }
+    }
+}
+
+void TransformNormals(const float* x, const float* y, const float* z, int count,
+                      const float m[3][3], float* outX, float* outY, float* outZ) {
+    int i = 0;
+    if (LANES > 1) {
+        vfloat M[3][3];
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++)
+                M[r][c] = vf_set1(m[r][c]);
+        }
+        vfloat zero = vf_set1(0.0f), one = vf_set1(1.0f);
+        for (; i + LANES <= count; i += LANES) {
+            vfloat vx = vf_load(x + i), vy = vf_load(y + i), vz = vf_load(z + i);
+            vfloat n[3];
+            for (int c = 0; c < 3; c++) {
+                vfloat t = vf_add(vf_mul(vx, M[0][c]), vf_mul(vy, M[1][c]));
+                n[c]     = vf_add(t, vf_mul(vz, M[2][c]));
+            }
+            vfloat len2 = vf_add(vf_add(vf_mul(n[0], n[0]), vf_mul(n[1], n[1])), vf_mul(n[2], n[2]));
+            vfloat len  = vf_sqrt(len2);
+            len         = vf_select(vf_eq(len, zero), one, len);
+            vf_store(outX + i, vf_div(n[0], len));
+            vf_store(outY + i, vf_div(n[1], len));
+            vf_store(outZ + i, vf_div(n[2], len));
+        }
+    }
+    for (; i < count; i++) {
+        float n[3];
+        for (int c = 0; c < 3; c++)
+            n[c] = x[i] * m[0][c] + y[i] * m[1][c] + z[i] * m[2][c];
+        float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (len == 0.0f) len = 1.0f;
+        outX[i] = n[0] / len;
+        outY[i] = n[1] / len;
+        outZ[i] = n[2] / len;
+    }
+}
+
+const KernelTable* GetTable() {
+    static const KernelTable table = {
+        KERNEL_PATH,     KERNEL_NAME,        &EdgeCoverage,     &BarycentricSpan,
+        &Interpolate,    &BilinearFilter,    &PackColors,       &ResolveColors,
+        &TransformPositions, &TransformInstances, &TransformNormals,
+    };
+    return &table;
+}
+
+} // namespace KERNEL_NAMESPACE
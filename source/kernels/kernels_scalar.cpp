@@ -0,0 +1,7 @@
+#define KERNEL_NAMESPACE kernels_scalar
+#define KERNEL_ISA_SCALAR
+#define KERNEL_PATH KernelPath::Scalar
+#define KERNEL_NAME "scalar"
+#include "kernels_impl.h"
+
+const KernelTable* GetScalarKernels() { return kernels_scalar::GetTable(); }
@@ -0,0 +1,13 @@
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define KERNEL_NAMESPACE kernels_sse42
+#define KERNEL_ISA_SSE42
+#define KERNEL_PATH KernelPath::SSE42
+#define KERNEL_NAME "sse4.2"
+#include "kernels_impl.h"
+
+const KernelTable* GetSSE42Kernels() { return kernels_sse42::GetTable(); }
+#else
+const KernelTable* GetSSE42Kernels() { return nullptr; }
+#endif
@@ -1,15 +1,17 @@
 #include "renderer.h"
 
 int main() {
-    auto       model      = std::make_shared<Model>("../obj/diablo3_pose.obj");
-    WindowInfo windowInfo = {"Core", 0, 0, 900, 600};
+    WindowInfo windowInfo = {"Core", 0, 0, 900, 600, MSAA_SAMPLES};
     Renderer   renderer   = Renderer(windowInfo);
     Scene      scene;
     Vec3f      lightPos   = {1, 1, 0.85};
     Vec3f      lightColor = {1, 1, 1};
     Vec3f      lightDir   = {1, 1, 0.85};
-    scene.AddLight(std::make_shared<DirectionalLight>(lightPos, lightColor, lightDir));
-    scene.AddModel(model);
+    auto       sun        = std::make_shared<DirectionalLight>(lightPos, lightColor, lightDir);
+    sun->SetCastShadow(true);
+    scene.AddLight(sun);
+    renderer.SetTemporalReuse(true);
+    scene.AddModel(Model::LoadAsync("../obj/diablo3_pose.obj"));
     renderer.RenderScene(scene);
     return 0;
 }
@@ -7,9 +7,17 @@
 #include <cstring>
 #include <string>
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "../kernels/kernels.h"
+#include "mapped_file.h"
 #include "math.h"
 
 class Bitmap {
+    friend class CompressedBitmap;
+
 public:
     inline virtual ~Bitmap() {
         if (m_bits) delete[] m_bits;
@@ -136,44 +144,40 @@ public:
     };
 
     // 读取 BMP 图片，支持 24/32 位两种格式
-    inline static Bitmap* LoadFile(const char* filename) {
-        FILE* fp = fopen(filename, "rb");
-        if (fp == NULL) return NULL;
+    // 整个文件映射进内存后逐行转换，flipVertical 为 true 时在同一遍中完成上下翻转
+    inline static Bitmap* LoadFile(const char* filename, bool flipVertical = false) {
+        MappedFile file(filename);
+        if (!file.IsOpen()) return NULL;
+        const uint8_t* data = file.GetData();
+        size_t         size = file.GetSize();
+        if (size < 14 + sizeof(BITMAPINFOHEADER)) return NULL;
+        if (data[0] != 0x42 || data[1] != 0x4d) return NULL;
         BITMAPINFOHEADER info;
-        uint8_t          header[14];
-        int              hr = (int)fread(header, 1, 14, fp);
-        if (hr != 14) {
-            fclose(fp);
-            return NULL;
-        }
-        if (header[0] != 0x42 || header[1] != 0x4d) {
-            fclose(fp);
-            return NULL;
-        }
-        hr = (int)fread(&info, 1, sizeof(info), fp);
-        if (hr != 40) {
-            fclose(fp);
-            return NULL;
-        }
-        if (info.biBitCount != 24 && info.biBitCount != 32) {
-            fclose(fp);
-            return NULL;
-        }
-        Bitmap*  bmp = new Bitmap(info.biWidth, info.biHeight);
+        memcpy(&info, data + 14, sizeof(info));
+        if (info.biSize < 40) return NULL;
+        if (info.biBitCount != 24 && info.biBitCount != 32) return NULL;
         uint32_t offset;
-        memcpy(&offset, header + 10, sizeof(uint32_t));
-        fseek(fp, offset, SEEK_SET);
+        memcpy(&offset, data + 10, sizeof(uint32_t));
+        // biHeight 为负表示自上而下存储
+        bool     bottomUp  = info.biHeight > 0;
+        int      width     = (int)info.biWidth;
+        int      height    = bottomUp ? info.biHeight : -info.biHeight;
         uint32_t pixelsize = (info.biBitCount + 7) / 8;
         uint32_t pitch     = (pixelsize * info.biWidth + 3) & (~3);
-        for (int y = 0; y < (int)info.biHeight; y++) {
-            uint8_t* line = bmp->GetLine(info.biHeight - 1 - y);
-            for (int x = 0; x < (int)info.biWidth; x++, line += 4) {
-                line[3] = 255;
-                fread(line, pixelsize, 1, fp);
+        if (width <= 0 || height <= 0) return NULL;
+        if (offset + (size_t)pitch * (height - 1) + (size_t)pixelsize * width > size) return NULL;
+        Bitmap* bmp = new Bitmap(width, height);
+        for (int y = 0; y < height; y++) {
+            // 文件中第 y 行对应的图像行（自上而下计数）
+            int            row  = bottomUp ? height - 1 - y : y;
+            uint8_t*       line = bmp->GetLine(flipVertical ? height - 1 - row : row);
+            const uint8_t* src  = data + offset + (size_t)pitch * y;
+            if (pixelsize == 4) {
+                memcpy(line, src, (size_t)width * 4);
+            } else {
+                ExpandBGR(src, line, width);
             }
-            fseek(fp, pitch - info.biWidth * pixelsize, SEEK_CUR);
         }
-        fclose(fp);
         return bmp;
     }
 
@@ -273,31 +277,39 @@ public:
     }
 
 protected:
+    // 24 位 BGR 扩展为 32 位 BGRA，alpha 填 255
+    inline static void ExpandBGR(const uint8_t* src, uint8_t* dst, int count) {
+        int x = 0;
+#if defined(__SSSE3__)
+        // 每次处理 4 个像素，读取 16 字节，要求后面至少还有 16 字节可读
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha   = _mm_set1_epi32((int)0xff000000);
+        for (; x + 6 <= count; x += 4) {
+            __m128i bgr = _mm_loadu_si128((const __m128i*)(src + x * 3));
+            __m128i out = _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), alpha);
+            _mm_storeu_si128((__m128i*)(dst + x * 4), out);
+        }
+#endif
+        // 每个像素按 32 位读取（多读的 1 字节被 alpha 覆盖），最后一个像素单独处理
+        for (; x + 1 < count; x++) {
+            uint32_t c;
+            memcpy(&c, src + x * 3, sizeof(uint32_t));
+            c |= 0xff000000;
+            memcpy(dst + x * 4, &c, sizeof(uint32_t));
+        }
+        for (; x < count; x++) {
+            dst[x * 4 + 0] = src[x * 3 + 0];
+            dst[x * 4 + 1] = src[x * 3 + 1];
+            dst[x * 4 + 2] = src[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+
     // 双线性插值计算：给出四个点的颜色，以及坐标偏移，计算结果
+    // 按 CPU 支持的指令集选择实现（kernels/kernels.h）
     inline static uint32_t BilinearInterp(uint32_t tl, uint32_t tr, uint32_t bl, uint32_t br,
                                           int32_t distx, int32_t disty) {
-        uint32_t f, r;
-        int32_t  distxy   = distx * disty;
-        int32_t  distxiy  = (distx << 8) - distxy; /* distx * (256 - disty) */
-        int32_t  distixy  = (disty << 8) - distxy; /* disty * (256 - distx) */
-        int32_t  distixiy = 256 * 256 - (disty << 8) - (distx << 8) + distxy;
-        r                 = (tl & 0x000000ff) * distixiy + (tr & 0x000000ff) * distxiy +
-            (bl & 0x000000ff) * distixy + (br & 0x000000ff) * distxy;
-        f = (tl & 0x0000ff00) * distixiy + (tr & 0x0000ff00) * distxiy +
-            (bl & 0x0000ff00) * distixy + (br & 0x0000ff00) * distxy;
-        r |= f & 0xff000000;
-        tl >>= 16;
-        tr >>= 16;
-        bl >>= 16;
-        br >>= 16;
-        r >>= 16;
-        f = (tl & 0x000000ff) * distixiy + (tr & 0x000000ff) * distxiy +
-            (bl & 0x000000ff) * distixy + (br & 0x000000ff) * distxy;
-        r |= f & 0x00ff0000;
-        f = (tl & 0x0000ff00) * distixiy + (tr & 0x0000ff00) * distxiy +
-            (bl & 0x0000ff00) * distixy + (br & 0x0000ff00) * distxy;
-        r |= f & 0xff000000;
-        return r;
+        return GetKernels().bilinearFilter(tl, tr, bl, br, distx, disty);
     }
 
 protected:
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "math.h"
+
+// 透视相机：缓存观察、投影、观察投影矩阵和视锥平面
+// 修改参数只做标记，Update 时只重算变化的部分；参数和原来相同时什么也不做
+class Camera {
+public:
+    void LookAt(const Vec3f& eye, const Vec3f& at, const Vec3f& up) {
+        if (eye == m_eye && at == m_at && up == m_up) return;
+        m_eye       = eye;
+        m_at        = at;
+        m_up        = up;
+        m_viewDirty = true;
+    }
+
+    // fovy 是竖直方向的视角（弧度）
+    void SetPerspective(float fovy, float zNear, float zFar) {
+        if (fovy == m_fovy && zNear == m_zNear && zFar == m_zFar) return;
+        m_fovy      = fovy;
+        m_zNear     = zNear;
+        m_zFar      = zFar;
+        m_projDirty = true;
+    }
+
+    // Renderer 每帧按窗口大小设置
+    void SetAspect(float aspect) {
+        if (aspect == m_aspect) return;
+        m_aspect    = aspect;
+        m_projDirty = true;
+    }
+
+    // 每帧绘制前调用，返回矩阵是否有变化
+    bool Update() {
+        if (!m_viewDirty && !m_projDirty) return false;
+        if (m_viewDirty) m_view = matrix_set_lookat(m_eye, m_at, m_up);
+        if (m_projDirty) m_proj = matrix_set_perspective(m_fovy, m_aspect, m_zNear, m_zFar);
+        m_viewProj  = m_view * m_proj;
+        m_viewDirty = m_projDirty = false;
+        UpdateFrustum();
+        m_version++;
+        return true;
+    }
+
+    // 包围球是否和视锥相交（保守判断，只用 6 个平面）
+    [[nodiscard]] bool SphereVisible(const Vec3f& center, float radius) const {
+        for (const Vec4f& plane : m_frustum) {
+            if (vector_dot(plane.xyz(), center) + plane.w < -radius) return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] const Mat4x4f&              View() const { return m_view; }
+    [[nodiscard]] const Mat4x4f&              Proj() const { return m_proj; }
+    [[nodiscard]] const Mat4x4f&              ViewProj() const { return m_viewProj; }
+    [[nodiscard]] const std::array<Vec4f, 6>& Frustum() const { return m_frustum; }
+    [[nodiscard]] const Vec3f&                Eye() const { return m_eye; }
+    [[nodiscard]] float                       Fovy() const { return m_fovy; }
+    [[nodiscard]] float                       Aspect() const { return m_aspect; }
+    // 矩阵每变化一次加一
+    [[nodiscard]] uint32_t Version() const { return m_version; }
+
+private:
+    // 行向量约定 clip = v * M：平面由 M 的列组合得到（左右下上近远），法线指向视锥内部
+    void UpdateFrustum() {
+        Vec4f col[4];
+        for (int c = 0; c < 4; c++)
+            col[c] = Vec4f(m_viewProj.m[0][c], m_viewProj.m[1][c], m_viewProj.m[2][c],
+                           m_viewProj.m[3][c]);
+        m_frustum = {col[3] + col[0], col[3] - col[0], col[3] + col[1],
+                     col[3] - col[1], col[2],          col[3] - col[2]};
+        for (Vec4f& plane : m_frustum)
+            plane = plane / vector_length(plane.xyz());
+    }
+
+private:
+    Vec3f                m_eye{0.0f, 0.0f, 2.0f};
+    Vec3f                m_at{0.0f, 0.0f, 0.0f};
+    Vec3f                m_up{0.0f, 1.0f, 0.0f};
+    float                m_fovy{3.1415926f * 0.5f};
+    float                m_aspect{9.0f / 6.0f};
+    float                m_zNear{1.0f};
+    float                m_zFar{500.0f};
+    bool                 m_viewDirty{true};
+    bool                 m_projDirty{true};
+    uint32_t             m_version{0};
+    Mat4x4f              m_view;
+    Mat4x4f              m_proj;
+    Mat4x4f              m_viewProj;
+    std::array<Vec4f, 6> m_frustum;
+};
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "bitmap.h"
+#include "math.h"
+
+// 块压缩格式，每个块覆盖 4x4 个像素
+enum class BlockFormat {
+    BC1, // RGB：两个 565 端点 + 2bit 索引，8 字节/块
+    BC4, // 单通道（取蓝色通道），8 字节/块
+    BC5, // 双通道（红/绿），16 字节/块，蓝色通道按单位法线重建
+};
+
+// 块压缩纹理：加载时从 Bitmap 编码，采样时按块解码
+// 解码后的块放在每个线程私有的小缓存中，双线性采样的相邻像素大多落在同一个块里
+class CompressedBitmap {
+public:
+    inline CompressedBitmap(const Bitmap& src, BlockFormat format)
+        : m_width(src.GetW()), m_height(src.GetH()), m_format(format) {
+        m_id         = NextId();
+        m_blocksX    = (m_width + 3) / 4;
+        m_blocksY    = (m_height + 3) / 4;
+        m_blockBytes = (format == BlockFormat::BC5) ? 16 : 8;
+        m_blocks.resize((size_t)m_blocksX * m_blocksY * m_blockBytes);
+        for (int by = 0; by < m_blocksY; by++) {
+            for (int bx = 0; bx < m_blocksX; bx++) {
+                // 边缘不足 4x4 的块重复最后一行/列
+                uint32_t texels[16];
+                for (int j = 0; j < 4; j++) {
+                    int y = Min(by * 4 + j, m_height - 1);
+                    for (int i = 0; i < 4; i++) {
+                        int x              = Min(bx * 4 + i, m_width - 1);
+                        texels[j * 4 + i] = src.GetPixel(x, y);
+                    }
+                }
+                EncodeBlock(texels, GetBlock(bx, by));
+            }
+        }
+    }
+
+public:
+    inline int         GetW() const { return m_width; }
+    inline int         GetH() const { return m_height; }
+    inline BlockFormat GetFormat() const { return m_format; }
+    inline size_t      GetSize() const { return m_blocks.size(); }
+
+    // 读取单个像素，格式与 Bitmap::GetPixel 相同
+    inline uint32_t GetPixel(int x, int y) const {
+        if (x < 0 || x >= m_width || y < 0 || y >= m_height) return 0;
+        const uint32_t* texels = FetchBlock(x >> 2, y >> 2);
+        return texels[(y & 3) * 4 + (x & 3)];
+    }
+
+    // 双线性插值，与 Bitmap::SampleBilinear 保持一致
+    inline uint32_t SampleBilinear(float x, float y) const {
+        int32_t fx = (int32_t)(x * 0x10000);
+        int32_t fy = (int32_t)(y * 0x10000);
+        int32_t x1 = Between(0, m_width - 1, fx >> 16);
+        int32_t y1 = Between(0, m_height - 1, fy >> 16);
+        int32_t x2 = Between(0, m_width - 1, x1 + 1);
+        int32_t y2 = Between(0, m_height - 1, y1 + 1);
+        int32_t dx = (fx >> 8) & 0xff;
+        int32_t dy = (fy >> 8) & 0xff;
+        if (m_width <= 0 || m_height <= 0) return 0;
+        uint32_t c00 = GetPixel(x1, y1);
+        uint32_t c01 = GetPixel(x2, y1);
+        uint32_t c10 = GetPixel(x1, y2);
+        uint32_t c11 = GetPixel(x2, y2);
+        return Bitmap::BilinearInterp(c00, c01, c10, c11, dx, dy);
+    }
+
+    // 纹理采样
+    inline Vec4f Sample2D(float u, float v) const {
+        uint32_t rgba = SampleBilinear(u * m_width + 0.5f, v * m_height + 0.5f);
+        return vector_from_color(rgba);
+    }
+
+    // 纹理采样：直接传入 Vec2f
+    inline Vec4f Sample2D(const Vec2f& uv) const { return Sample2D(uv.x, uv.y); }
+
+protected:
+    static constexpr int CACHE_SIZE = 64;
+
+    // 线程私有的解码块缓存，直接映射
+    struct BlockCacheEntry {
+        uint32_t id{0};
+        int32_t  block{-1};
+        uint32_t texels[16];
+    };
+
+    inline static uint32_t NextId() {
+        static std::atomic<uint32_t> counter{1};
+        return counter++;
+    }
+
+    inline uint8_t*       GetBlock(int bx, int by) {
+        return m_blocks.data() + ((size_t)by * m_blocksX + bx) * m_blockBytes;
+    }
+    inline const uint8_t* GetBlock(int bx, int by) const {
+        return m_blocks.data() + ((size_t)by * m_blocksX + bx) * m_blockBytes;
+    }
+
+    inline const uint32_t* FetchBlock(int bx, int by) const {
+        thread_local BlockCacheEntry cache[CACHE_SIZE];
+        int32_t                      block = by * m_blocksX + bx;
+        // 相邻块映射到相邻槽位，不同纹理用 id 错开
+        BlockCacheEntry& entry = cache[(block + m_id * 17) & (CACHE_SIZE - 1)];
+        if (entry.id != m_id || entry.block != block) {
+            DecodeBlock(GetBlock(bx, by), entry.texels);
+            entry.id    = m_id;
+            entry.block = block;
+        }
+        return entry.texels;
+    }
+
+    inline void EncodeBlock(const uint32_t texels[16], uint8_t* out) const {
+        uint8_t channel[16];
+        switch (m_format) {
+        case BlockFormat::BC1:
+            EncodeBC1(texels, out);
+            break;
+        case BlockFormat::BC4:
+            for (int i = 0; i < 16; i++)
+                channel[i] = texels[i] & 0xff;
+            EncodeBC4(channel, out);
+            break;
+        case BlockFormat::BC5:
+            for (int i = 0; i < 16; i++)
+                channel[i] = (texels[i] >> 16) & 0xff;
+            EncodeBC4(channel, out);
+            for (int i = 0; i < 16; i++)
+                channel[i] = (texels[i] >> 8) & 0xff;
+            EncodeBC4(channel, out + 8);
+            break;
+        }
+    }
+
+    inline void DecodeBlock(const uint8_t* block, uint32_t texels[16]) const {
+        uint8_t x[16], y[16];
+        switch (m_format) {
+        case BlockFormat::BC1:
+            DecodeBC1(block, texels);
+            break;
+        case BlockFormat::BC4:
+            DecodeBC4(block, x);
+            for (int i = 0; i < 16; i++)
+                texels[i] = 0xff000000 | (x[i] << 16) | (x[i] << 8) | x[i];
+            break;
+        case BlockFormat::BC5:
+            DecodeBC4(block, x);
+            DecodeBC4(block + 8, y);
+            for (int i = 0; i < 16; i++) {
+                // 由 x/y 重建单位法线的 z 分量
+                float nx  = x[i] * (2.0f / 255.0f) - 1.0f;
+                float ny  = y[i] * (2.0f / 255.0f) - 1.0f;
+                float nz  = sqrtf(Max(0.0f, 1.0f - nx * nx - ny * ny));
+                auto  z   = (uint32_t)((nz * 0.5f + 0.5f) * 255.0f + 0.5f);
+                texels[i] = 0xff000000 | (x[i] << 16) | (y[i] << 8) | z;
+            }
+            break;
+        }
+    }
+
+    inline static uint16_t PackRGB565(const Vec3f& c) {
+        auto r = (uint16_t)Between(0, 31, (int)(c.r * (31.0f / 255.0f) + 0.5f));
+        auto g = (uint16_t)Between(0, 63, (int)(c.g * (63.0f / 255.0f) + 0.5f));
+        auto b = (uint16_t)Between(0, 31, (int)(c.b * (31.0f / 255.0f) + 0.5f));
+        return (r << 11) | (g << 5) | b;
+    }
+
+    inline static Vec3i UnpackRGB565(uint16_t c) {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+    }
+
+    // BC1 编码：沿主轴方向取两个端点，再为每个像素选最近的调色板颜色
+    inline static void EncodeBC1(const uint32_t texels[16], uint8_t* out) {
+        Vec3f colors[16];
+        Vec3f mean;
+        for (int i = 0; i < 16; i++) {
+            colors[i] = Vec3f((float)((texels[i] >> 16) & 0xff), (float)((texels[i] >> 8) & 0xff),
+                              (float)(texels[i] & 0xff));
+            mean += colors[i];
+        }
+        mean = mean / 16.0f;
+
+        // 协方差矩阵 + 幂迭代求主轴
+        float cov[6] = {0, 0, 0, 0, 0, 0};
+        for (int i = 0; i < 16; i++) {
+            Vec3f d = colors[i] - mean;
+            cov[0] += d.r * d.r;
+            cov[1] += d.r * d.g;
+            cov[2] += d.r * d.b;
+            cov[3] += d.g * d.g;
+            cov[4] += d.g * d.b;
+            cov[5] += d.b * d.b;
+        }
+        Vec3f axis(1.0f, 1.0f, 1.0f);
+        for (int iter = 0; iter < 4; iter++) {
+            Vec3f next(axis.r * cov[0] + axis.g * cov[1] + axis.b * cov[2],
+                       axis.r * cov[1] + axis.g * cov[3] + axis.b * cov[4],
+                       axis.r * cov[2] + axis.g * cov[4] + axis.b * cov[5]);
+            float len = vector_length(next);
+            if (len < 1e-6f) break;
+            axis = next / len;
+        }
+
+        float minProj = 1e30f, maxProj = -1e30f;
+        Vec3f minColor = mean, maxColor = mean;
+        for (int i = 0; i < 16; i++) {
+            float proj = vector_dot(colors[i] - mean, axis);
+            if (proj < minProj) minProj = proj, minColor = colors[i];
+            if (proj > maxProj) maxProj = proj, maxColor = colors[i];
+        }
+
+        uint16_t c0 = PackRGB565(maxColor);
+        uint16_t c1 = PackRGB565(minColor);
+        if (c0 < c1) std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            // c0 > c1 时为四色模式
+            Vec3i e0 = UnpackRGB565(c0), e1 = UnpackRGB565(c1);
+            Vec3i palette[4] = {e0, e1, (e0 * 2 + e1) / 3, (e0 + e1 * 2) / 3};
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestDist = 1 << 30;
+                for (int p = 0; p < 4; p++) {
+                    Vec3i d(palette[p].r - (int)colors[i].r, palette[p].g - (int)colors[i].g,
+                            palette[p].b - (int)colors[i].b);
+                    int dist = vector_dot(d, d);
+                    if (dist < bestDist) bestDist = dist, best = p;
+                }
+                indices |= (uint32_t)best << (i * 2);
+            }
+        }
+        memcpy(out, &c0, 2);
+        memcpy(out + 2, &c1, 2);
+        memcpy(out + 4, &indices, 4);
+    }
+
+    inline static void DecodeBC1(const uint8_t* block, uint32_t texels[16]) {
+        uint16_t c0, c1;
+        uint32_t indices;
+        memcpy(&c0, block, 2);
+        memcpy(&c1, block + 2, 2);
+        memcpy(&indices, block + 4, 4);
+        Vec3i    e0 = UnpackRGB565(c0), e1 = UnpackRGB565(c1);
+        uint32_t palette[4];
+        auto     pack = [](const Vec3i& c) -> uint32_t {
+            return 0xff000000 | (c.r << 16) | (c.g << 8) | c.b;
+        };
+        palette[0] = pack(e0);
+        palette[1] = pack(e1);
+        if (c0 > c1) {
+            palette[2] = pack((e0 * 2 + e1) / 3);
+            palette[3] = pack((e0 + e1 * 2) / 3);
+        } else {
+            palette[2] = pack((e0 + e1) / 2);
+            palette[3] = 0;
+        }
+        for (int i = 0; i < 16; i++)
+            texels[i] = palette[(indices >> (i * 2)) & 3];
+    }
+
+    // BC4 编码：八值插值模式，端点取块内最大/最小值
+    inline static void EncodeBC4(const uint8_t values[16], uint8_t* out) {
+        uint8_t a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; i++) {
+            a0 = Max(a0, values[i]);
+            a1 = Min(a1, values[i]);
+        }
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            uint8_t palette[8];
+            Bc4Palette(a0, a1, palette);
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestDist = 256;
+                for (int p = 0; p < 8; p++) {
+                    int dist = Abs((int)palette[p] - (int)values[i]);
+                    if (dist < bestDist) bestDist = dist, best = p;
+                }
+                indices |= (uint64_t)best << (i * 3);
+            }
+        }
+        out[0] = a0;
+        out[1] = a1;
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = (uint8_t)(indices >> (i * 8));
+    }
+
+    inline static void DecodeBC4(const uint8_t* block, uint8_t values[16]) {
+        uint8_t palette[8];
+        Bc4Palette(block[0], block[1], palette);
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= (uint64_t)block[2 + i] << (i * 8);
+        for (int i = 0; i < 16; i++)
+            values[i] = palette[(indices >> (i * 3)) & 7];
+    }
+
+    inline static void Bc4Palette(uint8_t a0, uint8_t a1, uint8_t palette[8]) {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i < 7; i++)
+                palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+        } else {
+            for (int i = 1; i < 5; i++)
+                palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+protected:
+    int32_t              m_width;
+    int32_t              m_height;
+    int32_t              m_blocksX;
+    int32_t              m_blocksY;
+    int32_t              m_blockBytes;
+    uint32_t             m_id;
+    BlockFormat          m_format;
+    std::vector<uint8_t> m_blocks;
+};
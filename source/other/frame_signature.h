@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// 逐字节累加的 FNV-1a 哈希，用来判断两帧之间场景、相机和渲染设置是否完全相同
+class FrameSignature {
+public:
+    template <typename T> FrameSignature& Add(const T& value) {
+        // 数学库的向量和矩阵自定义了拷贝构造，所以只要求布局是纯数据
+        static_assert(std::is_standard_layout_v<T>, "FrameSignature 只接受可逐字节比较的类型");
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (unsigned char byte : bytes) {
+            m_hash ^= byte;
+            m_hash *= 1099511628211ull;
+        }
+        return *this;
+    }
+
+    [[nodiscard]] uint64_t Value() const { return m_hash; }
+
+private:
+    uint64_t m_hash{14695981039346656037ull};
+};
@@ -1,18 +1,43 @@
 #pragma once
 
+#include <cmath>
+
 #include "math.h"
 
+enum class LightType : uint8_t {
+    Directional, // 整个场景一个方向，每个光源绘制一遍
+    Point,       // 有作用范围，按屏幕块剔除后在一遍里累加
+    Spot,
+};
+
+// 着色时使用的局部光源参数（世界空间）
+// 点光源的 cosOuter 为 -2，锥形衰减恒为 1
+struct LocalLight {
+    Vec3f position;
+    float range;
+    Vec3f color;
+    float cosOuter;
+    Vec3f direction; // 聚光灯照射的方向
+    float cosInner;
+};
+
 class BasicLight {
 public:
     BasicLight(const Vec3f& lightPos, const Vec3f& lightColor)
         : m_lightPos(lightPos), m_lightColor(lightColor) {}
-    [[nodiscard]] Vec3f GetLightPos() const { return m_lightPos; }
-    [[nodiscard]] Vec3f GetLightColor() const { return m_lightColor; }
-    virtual Vec3f       GetLightDir() { return m_lightPos; }
+    virtual ~BasicLight() = default;
+    [[nodiscard]] Vec3f     GetLightPos() const { return m_lightPos; }
+    [[nodiscard]] Vec3f     GetLightColor() const { return m_lightColor; }
+    virtual Vec3f           GetLightDir() { return m_lightPos; }
+    [[nodiscard]] virtual LightType GetType() const { return LightType::Directional; }
+    // 目前只有方向光会生成阴影贴图
+    void                    SetCastShadow(bool castShadow) { m_castShadow = castShadow; }
+    [[nodiscard]] bool      CastShadow() const { return m_castShadow; }
 
 private:
     Vec3f m_lightPos{1.0f, 1.0f, 1.0f};
     Vec3f m_lightColor{1.0f, 1.0f, 1.0f};
+    bool  m_castShadow{false};
 };
 
 class DirectionalLight : public BasicLight {
@@ -23,4 +48,40 @@ public:
 
 private:
     Vec3f m_lightDir{1, 1, 0.85};
-};
\ No newline at end of file
+};
+
+// 点光源：强度随距离衰减，到 range 处正好为 0
+class PointLight : public BasicLight {
+public:
+    PointLight(const Vec3f& lightPos, const Vec3f& lightColor, float range)
+        : BasicLight(lightPos, lightColor), m_range(range) {}
+    [[nodiscard]] LightType GetType() const override { return LightType::Point; }
+    [[nodiscard]] float     GetRange() const { return m_range; }
+
+    [[nodiscard]] virtual LocalLight GetLocalLight() const {
+        return {GetLightPos(), m_range, GetLightColor(), -2.0f, Vec3f(0.0f, 0.0f, 1.0f), -1.0f};
+    }
+
+private:
+    float m_range{1.0f};
+};
+
+// 聚光灯：在点光源的基础上，内锥角以内全亮，外锥角以外为 0（角度是半角，弧度）
+class SpotLight : public PointLight {
+public:
+    SpotLight(const Vec3f& lightPos, const Vec3f& lightColor, float range, const Vec3f& lightDir,
+              float innerAngle, float outerAngle)
+        : PointLight(lightPos, lightColor, range), m_lightDir(vector_normalize(lightDir)),
+          m_cosInner(cosf(innerAngle)), m_cosOuter(cosf(outerAngle)) {}
+    [[nodiscard]] LightType GetType() const override { return LightType::Spot; }
+    Vec3f                   GetLightDir() override { return m_lightDir; }
+
+    [[nodiscard]] LocalLight GetLocalLight() const override {
+        return {GetLightPos(), GetRange(), GetLightColor(), m_cosOuter, m_lightDir, m_cosInner};
+    }
+
+private:
+    Vec3f m_lightDir{0.0f, 0.0f, 1.0f};
+    float m_cosInner{1.0f};
+    float m_cosOuter{0.7f};
+};
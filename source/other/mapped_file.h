@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读文件映射：POSIX 下使用 mmap，其他平台一次性读入内存
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const char* filename) { Open(filename); }
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile& other)            = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this == &other) return *this;
+        Close();
+        m_data   = other.m_data;
+        m_size   = other.m_size;
+        m_mapped = other.m_mapped;
+        m_buffer = std::move(other.m_buffer);
+        m_open   = other.m_open;
+        other.m_data   = nullptr;
+        other.m_size   = 0;
+        other.m_mapped = false;
+        other.m_open   = false;
+        return *this;
+    }
+
+public:
+    inline bool Open(const char* filename) {
+        Close();
+#if defined(_WIN32)
+        FILE* fp = fopen(filename, "rb");
+        if (fp == NULL) return false;
+        fseek(fp, 0, SEEK_END);
+        long size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        if (size < 0) {
+            fclose(fp);
+            return false;
+        }
+        m_buffer.resize((size_t)size);
+        size_t hr = fread(m_buffer.data(), 1, m_buffer.size(), fp);
+        fclose(fp);
+        if (hr != m_buffer.size()) {
+            m_buffer.clear();
+            return false;
+        }
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return false;
+        }
+        m_size = (size_t)st.st_size;
+        if (m_size > 0) {
+            void* ptr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                close(fd);
+                m_size = 0;
+                return false;
+            }
+            madvise(ptr, m_size, MADV_SEQUENTIAL);
+            m_data   = static_cast<const uint8_t*>(ptr);
+            m_mapped = true;
+        }
+        close(fd);
+#endif
+        m_open = true;
+        return true;
+    }
+
+    inline void Close() {
+#if !defined(_WIN32)
+        if (m_mapped) munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+        m_buffer.clear();
+        m_data   = nullptr;
+        m_size   = 0;
+        m_mapped = false;
+        m_open   = false;
+    }
+
+    inline bool           IsOpen() const { return m_open; }
+    inline const uint8_t* GetData() const { return m_data; }
+    inline size_t         GetSize() const { return m_size; }
+
+private:
+    const uint8_t*       m_data{nullptr};
+    size_t               m_size{0};
+    bool                 m_mapped{false};
+    bool                 m_open{false};
+    std::vector<uint8_t> m_buffer;
+};
@@ -2,6 +2,8 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <iostream>
 #include <ostream>
@@ -738,6 +740,288 @@ typedef Matrix<3, 3, float> Mat3x3f;
 typedef Matrix<4, 3, float> Mat4x3f;
 typedef Matrix<3, 4, float> Mat3x4f;
 
+//---------------------------------------------------------------------
+// SIMD 特化：Vec4f / Vec3f / Mat4x4f
+// 非模板重载在重载决议中优先于通用模板，调用方不需要改动
+// Vec3f 按 (x, y, z, 0) 装入寄存器，不会读写第四个 float 之外的内存
+// 加法顺序与通用模板保持一致，结果逐位相同
+//---------------------------------------------------------------------
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+
+inline __m128 simd_load(const Vec4f& a) { return _mm_loadu_ps(a.m); }
+inline __m128 simd_load(const Vec3f& a) { return _mm_set_ps(0.0f, a.z, a.y, a.x); }
+
+inline Vec4f simd_store4(__m128 v) {
+    Vec4f a;
+    _mm_storeu_ps(a.m, v);
+    return a;
+}
+
+inline Vec3f simd_store3(__m128 v) {
+    alignas(16) float t[4];
+    _mm_store_ps(t, v);
+    return Vec3f(t[0], t[1], t[2]);
+}
+
+// 水平求和，按 ((x + y) + z) + w 的顺序
+inline float simd_hsum(__m128 v) {
+    __m128 s = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    s        = _mm_add_ss(s, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)));
+    s        = _mm_add_ss(s, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)));
+    return _mm_cvtss_f32(s);
+}
+
+// (a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x, 0)
+inline __m128 simd_cross(__m128 a, __m128 b) {
+    __m128 a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 a2 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    return _mm_sub_ps(_mm_mul_ps(a1, b1), _mm_mul_ps(a2, b2));
+}
+
+// NaN 的处理与通用模板的比较写法一致
+inline __m128 simd_clamp(__m128 a, float minx, float maxx) {
+    __m128 x = _mm_max_ps(_mm_set1_ps(minx), a);
+    return _mm_min_ps(_mm_set1_ps(maxx), x);
+}
+
+// Vec4f
+inline Vec4f operator-(const Vec4f& a) {
+    return simd_store4(_mm_sub_ps(_mm_setzero_ps(), simd_load(a)));
+}
+inline Vec4f operator+(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_add_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f operator-(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_sub_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f operator*(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_mul_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f operator/(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_div_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f operator*(const Vec4f& a, float x) {
+    return simd_store4(_mm_mul_ps(simd_load(a), _mm_set1_ps(x)));
+}
+inline Vec4f operator*(float x, const Vec4f& a) { return a * x; }
+inline Vec4f operator/(const Vec4f& a, float x) {
+    return simd_store4(_mm_div_ps(simd_load(a), _mm_set1_ps(x)));
+}
+inline Vec4f& operator+=(Vec4f& a, const Vec4f& b) { return a = a + b; }
+inline Vec4f& operator-=(Vec4f& a, const Vec4f& b) { return a = a - b; }
+inline Vec4f& operator*=(Vec4f& a, const Vec4f& b) { return a = a * b; }
+inline Vec4f& operator*=(Vec4f& a, float x) { return a = a * x; }
+
+inline float vector_dot(const Vec4f& a, const Vec4f& b) {
+    return simd_hsum(_mm_mul_ps(simd_load(a), simd_load(b)));
+}
+inline float vector_length_square(const Vec4f& a) { return vector_dot(a, a); }
+inline float vector_length(const Vec4f& a) { return sqrtf(vector_dot(a, a)); }
+inline Vec4f vector_normalize(const Vec4f& a) {
+    __m128 v = simd_load(a);
+    __m128 l = _mm_sqrt_ss(_mm_set_ss(simd_hsum(_mm_mul_ps(v, v))));
+    return simd_store4(_mm_div_ps(v, _mm_shuffle_ps(l, l, 0)));
+}
+inline Vec4f vector_cross(const Vec4f& a, const Vec4f& b) {
+    Vec4f c = simd_store4(simd_cross(simd_load(a), simd_load(b)));
+    c.w     = a.w;
+    return c;
+}
+inline Vec4f vector_min(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_min_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f vector_max(const Vec4f& a, const Vec4f& b) {
+    return simd_store4(_mm_max_ps(simd_load(a), simd_load(b)));
+}
+inline Vec4f vector_clamp(const Vec4f& a, float minx = 0, float maxx = 1) {
+    return simd_store4(simd_clamp(simd_load(a), minx, maxx));
+}
+
+// Vec3f，按 4 分量补零处理
+inline Vec3f operator+(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(_mm_add_ps(simd_load(a), simd_load(b)));
+}
+inline Vec3f operator-(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(_mm_sub_ps(simd_load(a), simd_load(b)));
+}
+inline Vec3f operator*(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(_mm_mul_ps(simd_load(a), simd_load(b)));
+}
+inline Vec3f operator*(const Vec3f& a, float x) {
+    return simd_store3(_mm_mul_ps(simd_load(a), _mm_set1_ps(x)));
+}
+inline Vec3f operator*(float x, const Vec3f& a) { return a * x; }
+inline Vec3f& operator+=(Vec3f& a, const Vec3f& b) { return a = a + b; }
+inline Vec3f& operator-=(Vec3f& a, const Vec3f& b) { return a = a - b; }
+
+inline float vector_dot(const Vec3f& a, const Vec3f& b) {
+    __m128 m = _mm_mul_ps(simd_load(a), simd_load(b));
+    __m128 s = _mm_add_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1)));
+    s        = _mm_add_ss(s, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2)));
+    return _mm_cvtss_f32(s);
+}
+inline float vector_length_square(const Vec3f& a) { return vector_dot(a, a); }
+inline float vector_length(const Vec3f& a) { return sqrtf(vector_dot(a, a)); }
+inline Vec3f vector_normalize(const Vec3f& a) {
+    __m128 l = _mm_set1_ps(sqrtf(vector_dot(a, a)));
+    return simd_store3(_mm_div_ps(simd_load(a), l));
+}
+inline Vec3f vector_cross(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(simd_cross(simd_load(a), simd_load(b)));
+}
+inline Vec3f vector_min(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(_mm_min_ps(simd_load(a), simd_load(b)));
+}
+inline Vec3f vector_max(const Vec3f& a, const Vec3f& b) {
+    return simd_store3(_mm_max_ps(simd_load(a), simd_load(b)));
+}
+inline Vec3f vector_clamp(const Vec3f& a, float minx = 0, float maxx = 1) {
+    return simd_store3(simd_clamp(simd_load(a), minx, maxx));
+}
+
+// Mat4x4f，行向量约定：v * M = v.x * row0 + v.y * row1 + v.z * row2 + v.w * row3
+inline __m128 simd_mul_row(__m128 v, const Mat4x4f& m) {
+    __m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), _mm_loadu_ps(m.m[0]));
+    r        = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), _mm_loadu_ps(m.m[1])));
+    r        = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xaa), _mm_loadu_ps(m.m[2])));
+    r        = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xff), _mm_loadu_ps(m.m[3])));
+    return r;
+}
+
+inline Vec4f operator*(const Vec4f& a, const Mat4x4f& m) {
+    return simd_store4(simd_mul_row(simd_load(a), m));
+}
+
+// = (dot(row0, a), dot(row1, a), dot(row2, a), dot(row3, a))
+inline Vec4f operator*(const Mat4x4f& m, const Vec4f& a) {
+    __m128 v  = simd_load(a);
+    __m128 p0 = _mm_mul_ps(_mm_loadu_ps(m.m[0]), v);
+    __m128 p1 = _mm_mul_ps(_mm_loadu_ps(m.m[1]), v);
+    __m128 p2 = _mm_mul_ps(_mm_loadu_ps(m.m[2]), v);
+    __m128 p3 = _mm_mul_ps(_mm_loadu_ps(m.m[3]), v);
+    _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+    return simd_store4(_mm_add_ps(_mm_add_ps(_mm_add_ps(p0, p1), p2), p3));
+}
+
+inline Mat4x4f operator*(const Mat4x4f& a, const Mat4x4f& b) {
+    Mat4x4f out;
+#if defined(__AVX__)
+    // 一次处理两行：每个 128 位通道内广播 a 的元素，b 的行复制到两个通道
+    __m256 b0 = _mm256_broadcast_ps((const __m128*)b.m[0]);
+    __m256 b1 = _mm256_broadcast_ps((const __m128*)b.m[1]);
+    __m256 b2 = _mm256_broadcast_ps((const __m128*)b.m[2]);
+    __m256 b3 = _mm256_broadcast_ps((const __m128*)b.m[3]);
+    for (size_t j = 0; j < 4; j += 2) {
+        __m256 rows = _mm256_loadu_ps(a.m[j]);
+        __m256 r    = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x55), b1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xaa), b2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xff), b3));
+        _mm256_storeu_ps(out.m[j], r);
+    }
+#else
+    for (size_t j = 0; j < 4; j++)
+        _mm_storeu_ps(out.m[j], simd_mul_row(_mm_loadu_ps(a.m[j]), b));
+#endif
+    return out;
+}
+
+template <> inline Mat4x4f Mat4x4f::Transpose() const {
+    __m128 r0 = _mm_loadu_ps(m[0]);
+    __m128 r1 = _mm_loadu_ps(m[1]);
+    __m128 r2 = _mm_loadu_ps(m[2]);
+    __m128 r3 = _mm_loadu_ps(m[3]);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    Mat4x4f out;
+    _mm_storeu_ps(out.m[0], r0);
+    _mm_storeu_ps(out.m[1], r1);
+    _mm_storeu_ps(out.m[2], r2);
+    _mm_storeu_ps(out.m[3], r3);
+    return out;
+}
+
+// 4x4 逆矩阵的闭式解：按 2x2 分块求伴随矩阵，避免递归的余子式展开
+// 分块 M = | A B |，2x2 矩阵按行存在一个寄存器里
+//          | C D |
+
+// 2x2 矩阵乘法 A * B
+inline __m128 simd_mat2_mul(__m128 a, __m128 b) {
+    return _mm_add_ps(
+        _mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+        _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                   _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adj(A) * B
+inline __m128 simd_mat2_adj_mul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+                      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+                                 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// A * adj(B)
+inline __m128 simd_mat2_mul_adj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+                      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                                 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+inline Mat4x4f matrix_invert(const Mat4x4f& m) {
+    __m128 r0 = _mm_loadu_ps(m.m[0]);
+    __m128 r1 = _mm_loadu_ps(m.m[1]);
+    __m128 r2 = _mm_loadu_ps(m.m[2]);
+    __m128 r3 = _mm_loadu_ps(m.m[3]);
+    __m128 A  = _mm_movelh_ps(r0, r1);
+    __m128 B  = _mm_movehl_ps(r1, r0);
+    __m128 C  = _mm_movelh_ps(r2, r3);
+    __m128 D  = _mm_movehl_ps(r3, r2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 det = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(2, 0, 2, 0)),
+                                       _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(3, 1, 3, 1))),
+                            _mm_mul_ps(_mm_shuffle_ps(r0, r2, _MM_SHUFFLE(3, 1, 3, 1)),
+                                       _mm_shuffle_ps(r1, r3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 detA = _mm_shuffle_ps(det, det, 0x00);
+    __m128 detB = _mm_shuffle_ps(det, det, 0x55);
+    __m128 detC = _mm_shuffle_ps(det, det, 0xaa);
+    __m128 detD = _mm_shuffle_ps(det, det, 0xff);
+
+    // 逆矩阵 = 1/|M| * | X Y |，先求各块的伴随矩阵
+    //                  | Z W |
+    __m128 DC = simd_mat2_adj_mul(D, C);
+    __m128 AB = simd_mat2_adj_mul(A, B);
+    __m128 X  = _mm_sub_ps(_mm_mul_ps(detD, A), simd_mat2_mul(B, DC));
+    __m128 W  = _mm_sub_ps(_mm_mul_ps(detA, D), simd_mat2_mul(C, AB));
+    __m128 Y  = _mm_sub_ps(_mm_mul_ps(detB, C), simd_mat2_mul_adj(D, AB));
+    __m128 Z  = _mm_sub_ps(_mm_mul_ps(detC, B), simd_mat2_mul_adj(A, DC));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(AB, _mm_shuffle_ps(DC, DC, _MM_SHUFFLE(3, 1, 2, 0)));
+    tr        = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+    tr        = _mm_add_ss(tr, _mm_shuffle_ps(tr, tr, 0x55));
+    __m128 detM =
+        _mm_sub_ss(_mm_add_ss(_mm_mul_ss(detA, detD), _mm_mul_ss(detB, detC)), tr);
+    detM         = _mm_shuffle_ps(detM, detM, 0x00);
+    __m128 scale = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+
+    X = _mm_mul_ps(X, scale);
+    Y = _mm_mul_ps(Y, scale);
+    Z = _mm_mul_ps(Z, scale);
+    W = _mm_mul_ps(W, scale);
+
+    // 取伴随的同时重排回行存储
+    Mat4x4f out;
+    _mm_storeu_ps(out.m[0], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(out.m[1], _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_storeu_ps(out.m[2], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(out.m[3], _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2)));
+    return out;
+}
+#endif
+
 //---------------------------------------------------------------------
 // 3D 数学运算
 //---------------------------------------------------------------------
@@ -852,3 +1136,256 @@ static Mat4x4f matrix_set_perspective(float fovy, float aspect, float zn, float
     m.m[2][3]   = 1;
     return m;
 }
+
+// D3DXMatrixOrthoLH：z 从 [zn, zf] 线性映射到 [0, 1]，w 恒为 1
+static Mat4x4f matrix_set_ortho(float width, float height, float zn, float zf) {
+    Mat4x4f m = matrix_set_identity();
+    m.m[0][0] = 2.0f / width;
+    m.m[1][1] = 2.0f / height;
+    m.m[2][2] = 1.0f / (zf - zn);
+    m.m[3][2] = -zn / (zf - zn);
+    return m;
+}
+
+// 仿射矩阵求逆：前三行是旋转/缩放 L，第四行是平移 t
+// 逆矩阵为 | L^-1      0 |，L^-1 由行向量的叉乘（伴随矩阵）直接得到
+//          | -t L^-1   1 |
+static Mat4x4f matrix_invert_affine(const Mat4x4f& m) {
+    Vec3f r0 = Vec3f(m.m[0]), r1 = Vec3f(m.m[1]), r2 = Vec3f(m.m[2]);
+    Vec3f c0 = vector_cross(r1, r2), c1 = vector_cross(r2, r0), c2 = vector_cross(r0, r1);
+    float inv = 1.0f / vector_dot(r0, c0);
+    c0        = c0 * inv;
+    c1        = c1 * inv;
+    c2        = c2 * inv;
+    // c0/c1/c2 是 L^-1 的列
+    Vec3f   t(m.m[3]);
+    Mat4x4f out;
+    out.SetRow(0, Vec4f(c0.x, c1.x, c2.x, 0.0f));
+    out.SetRow(1, Vec4f(c0.y, c1.y, c2.y, 0.0f));
+    out.SetRow(2, Vec4f(c0.z, c1.z, c2.z, 0.0f));
+    out.SetRow(3, Vec4f(-vector_dot(t, c0), -vector_dot(t, c1), -vector_dot(t, c2), 1.0f));
+    return out;
+}
+
+// 法线矩阵：左上 3x3 的逆转置，等于余子式矩阵除以行列式，法线用 n * matrix_normal(m) 变换
+static Mat3x3f matrix_normal(const Mat4x4f& m) {
+    Vec3f r0 = Vec3f(m.m[0]), r1 = Vec3f(m.m[1]), r2 = Vec3f(m.m[2]);
+    Vec3f c0 = vector_cross(r1, r2), c1 = vector_cross(r2, r0), c2 = vector_cross(r0, r1);
+    float inv = 1.0f / vector_dot(r0, c0);
+    return Mat3x3f{c0 * inv, c1 * inv, c2 * inv};
+}
+
+//---------------------------------------------------------------------
+// 批量变换：SoA 排列的顶点流（x[]、y[]、z[] 各自连续）
+//---------------------------------------------------------------------
+
+// 裁剪空间 outcode，每一位表示顶点在对应裁剪面之外，和逐顶点的齐次裁剪条件一致
+enum ClipCode : uint8_t {
+    CLIP_LEFT   = 1 << 0, // x < -w
+    CLIP_RIGHT  = 1 << 1, // x > w
+    CLIP_BOTTOM = 1 << 2, // y < -w
+    CLIP_TOP    = 1 << 3, // y > w
+    CLIP_NEAR   = 1 << 4, // z < 0
+    CLIP_FAR    = 1 << 5, // z > w
+    CLIP_W_ZERO = 1 << 6, // w == 0，无法做透视除法
+};
+
+struct Vec3fSoA {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    size_t size() const { return x.size(); }
+    void   resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+    }
+};
+
+// 裁剪空间坐标、1/w 与 outcode
+struct ClipSoA {
+    std::vector<float>   x;
+    std::vector<float>   y;
+    std::vector<float>   z;
+    std::vector<float>   w;
+    std::vector<float>   rhw;
+    std::vector<uint8_t> outcode;
+
+    size_t size() const { return x.size(); }
+    void   resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        w.resize(n);
+        rhw.resize(n);
+        outcode.resize(n);
+    }
+};
+
+static uint8_t clip_outcode(float x, float y, float z, float w) {
+    uint8_t code = 0;
+    code |= (x < -w) ? CLIP_LEFT : 0;
+    code |= (x > w) ? CLIP_RIGHT : 0;
+    code |= (y < -w) ? CLIP_BOTTOM : 0;
+    code |= (y > w) ? CLIP_TOP : 0;
+    code |= (z < 0.0f) ? CLIP_NEAR : 0;
+    code |= (z > w) ? CLIP_FAR : 0;
+    code |= (w == 0.0f) ? CLIP_W_ZERO : 0;
+    return code;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+inline int simd_outcode(__m128 x, __m128 y, __m128 z, __m128 w) {
+    __m128  nw    = _mm_sub_ps(_mm_setzero_ps(), w);
+    __m128i code  = _mm_setzero_si128();
+    auto    flag  = [&code](__m128 mask, int bit) {
+        code = _mm_or_si128(code, _mm_and_si128(_mm_castps_si128(mask), _mm_set1_epi32(bit)));
+    };
+    flag(_mm_cmplt_ps(x, nw), CLIP_LEFT);
+    flag(_mm_cmpgt_ps(x, w), CLIP_RIGHT);
+    flag(_mm_cmplt_ps(y, nw), CLIP_BOTTOM);
+    flag(_mm_cmpgt_ps(y, w), CLIP_TOP);
+    flag(_mm_cmplt_ps(z, _mm_setzero_ps()), CLIP_NEAR);
+    flag(_mm_cmpgt_ps(z, w), CLIP_FAR);
+    flag(_mm_cmpeq_ps(w, _mm_setzero_ps()), CLIP_W_ZERO);
+    // 4 个 32 位 code 压成 4 个字节
+    code = _mm_packs_epi32(code, code);
+    code = _mm_packus_epi16(code, code);
+    return _mm_cvtsi128_si32(code);
+}
+#endif
+
+// 位置按 (x, y, z, 1) * m 变换到裁剪空间，同时输出 1/w 和 outcode
+// 乘加顺序和 Vec4f * Mat4x4f 相同，结果逐位一致
+static void batch_transform_positions(const float* x, const float* y, const float* z,
+                                      size_t count, const Mat4x4f& m, float* outX, float* outY,
+                                      float* outZ, float* outW, float* outRhw,
+                                      uint8_t* outcode) {
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i),
+               vz = _mm256_loadu_ps(z + i);
+        __m256 r[4];
+        for (int c = 0; c < 4; c++) {
+            __m256 t = _mm256_mul_ps(vx, _mm256_set1_ps(m.m[0][c]));
+            t        = _mm256_add_ps(t, _mm256_mul_ps(vy, _mm256_set1_ps(m.m[1][c])));
+            t        = _mm256_add_ps(t, _mm256_mul_ps(vz, _mm256_set1_ps(m.m[2][c])));
+            r[c]     = _mm256_add_ps(t, _mm256_set1_ps(m.m[3][c]));
+        }
+        _mm256_storeu_ps(outX + i, r[0]);
+        _mm256_storeu_ps(outY + i, r[1]);
+        _mm256_storeu_ps(outZ + i, r[2]);
+        _mm256_storeu_ps(outW + i, r[3]);
+        _mm256_storeu_ps(outRhw + i, _mm256_div_ps(_mm256_set1_ps(1.0f), r[3]));
+        int lo = simd_outcode(_mm256_castps256_ps128(r[0]), _mm256_castps256_ps128(r[1]),
+                              _mm256_castps256_ps128(r[2]), _mm256_castps256_ps128(r[3]));
+        int hi = simd_outcode(_mm256_extractf128_ps(r[0], 1), _mm256_extractf128_ps(r[1], 1),
+                              _mm256_extractf128_ps(r[2], 1), _mm256_extractf128_ps(r[3], 1));
+        memcpy(outcode + i, &lo, 4);
+        memcpy(outcode + i + 4, &hi, 4);
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 r[4];
+        for (int c = 0; c < 4; c++) {
+            __m128 t = _mm_mul_ps(vx, _mm_set1_ps(m.m[0][c]));
+            t        = _mm_add_ps(t, _mm_mul_ps(vy, _mm_set1_ps(m.m[1][c])));
+            t        = _mm_add_ps(t, _mm_mul_ps(vz, _mm_set1_ps(m.m[2][c])));
+            r[c]     = _mm_add_ps(t, _mm_set1_ps(m.m[3][c]));
+        }
+        _mm_storeu_ps(outX + i, r[0]);
+        _mm_storeu_ps(outY + i, r[1]);
+        _mm_storeu_ps(outZ + i, r[2]);
+        _mm_storeu_ps(outW + i, r[3]);
+        _mm_storeu_ps(outRhw + i, _mm_div_ps(_mm_set1_ps(1.0f), r[3]));
+        int code = simd_outcode(r[0], r[1], r[2], r[3]);
+        memcpy(outcode + i, &code, 4);
+    }
+#endif
+    for (; i < count; i++) {
+        float r[4];
+        for (int c = 0; c < 4; c++)
+            r[c] = x[i] * m.m[0][c] + y[i] * m.m[1][c] + z[i] * m.m[2][c] + m.m[3][c];
+        outX[i]    = r[0];
+        outY[i]    = r[1];
+        outZ[i]    = r[2];
+        outW[i]    = r[3];
+        outRhw[i]  = 1.0f / r[3];
+        outcode[i] = clip_outcode(r[0], r[1], r[2], r[3]);
+    }
+}
+
+static void batch_transform_positions(const Vec3fSoA& in, const Mat4x4f& m, ClipSoA& out) {
+    out.resize(in.size());
+    batch_transform_positions(in.x.data(), in.y.data(), in.z.data(), in.size(), m, out.x.data(),
+                              out.y.data(), out.z.data(), out.w.data(), out.rhw.data(),
+                              out.outcode.data());
+}
+
+// 法线按 n * m 变换（m 通常是 matrix_normal 的结果）并重新归一化，零向量保持为零
+static void batch_transform_normals(const float* x, const float* y, const float* z,
+                                    size_t count, const Mat3x3f& m, float* outX, float* outY,
+                                    float* outZ) {
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i),
+               vz = _mm256_loadu_ps(z + i);
+        __m256 r[3];
+        for (int c = 0; c < 3; c++) {
+            __m256 t = _mm256_mul_ps(vx, _mm256_set1_ps(m.m[0][c]));
+            t        = _mm256_add_ps(t, _mm256_mul_ps(vy, _mm256_set1_ps(m.m[1][c])));
+            r[c]     = _mm256_add_ps(t, _mm256_mul_ps(vz, _mm256_set1_ps(m.m[2][c])));
+        }
+        __m256 len2 = _mm256_mul_ps(r[0], r[0]);
+        len2        = _mm256_add_ps(len2, _mm256_mul_ps(r[1], r[1]));
+        len2        = _mm256_add_ps(len2, _mm256_mul_ps(r[2], r[2]));
+        __m256 len  = _mm256_sqrt_ps(len2);
+        __m256 zero = _mm256_cmp_ps(len, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        len         = _mm256_blendv_ps(len, _mm256_set1_ps(1.0f), zero);
+        _mm256_storeu_ps(outX + i, _mm256_div_ps(r[0], len));
+        _mm256_storeu_ps(outY + i, _mm256_div_ps(r[1], len));
+        _mm256_storeu_ps(outZ + i, _mm256_div_ps(r[2], len));
+    }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4) {
+        __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        __m128 r[3];
+        for (int c = 0; c < 3; c++) {
+            __m128 t = _mm_mul_ps(vx, _mm_set1_ps(m.m[0][c]));
+            t        = _mm_add_ps(t, _mm_mul_ps(vy, _mm_set1_ps(m.m[1][c])));
+            r[c]     = _mm_add_ps(t, _mm_mul_ps(vz, _mm_set1_ps(m.m[2][c])));
+        }
+        __m128 len2 = _mm_mul_ps(r[0], r[0]);
+        len2        = _mm_add_ps(len2, _mm_mul_ps(r[1], r[1]));
+        len2        = _mm_add_ps(len2, _mm_mul_ps(r[2], r[2]));
+        __m128 len  = _mm_sqrt_ps(len2);
+        __m128 zero = _mm_cmpeq_ps(len, _mm_setzero_ps());
+        len = _mm_or_ps(_mm_andnot_ps(zero, len), _mm_and_ps(zero, _mm_set1_ps(1.0f)));
+        _mm_storeu_ps(outX + i, _mm_div_ps(r[0], len));
+        _mm_storeu_ps(outY + i, _mm_div_ps(r[1], len));
+        _mm_storeu_ps(outZ + i, _mm_div_ps(r[2], len));
+    }
+#endif
+    for (; i < count; i++) {
+        float r[3];
+        for (int c = 0; c < 3; c++)
+            r[c] = x[i] * m.m[0][c] + y[i] * m.m[1][c] + z[i] * m.m[2][c];
+        float len = sqrtf(r[0] * r[0] + r[1] * r[1] + r[2] * r[2]);
+        if (len == 0.0f) len = 1.0f;
+        outX[i] = r[0] / len;
+        outY[i] = r[1] / len;
+        outZ[i] = r[2] / len;
+    }
+}
+
+static void batch_transform_normals(const Vec3fSoA& in, const Mat3x3f& m, Vec3fSoA& out) {
+    out.resize(in.size());
+    batch_transform_normals(in.x.data(), in.y.data(), in.z.data(), in.size(), m, out.x.data(),
+                            out.y.data(), out.z.data());
+}
@@ -0,0 +1,466 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mapped_file.h"
+#include "math.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_parser.h"
+
+// 交错存储的顶点，法线已经归一化
+struct MeshVertex {
+    Vec3f pos;
+    Vec3f normal;
+    Vec2f uv;
+};
+
+// 一组相邻的三角形，带包围球，方便按块剔除
+struct Meshlet {
+    uint32_t triangleOffset; // 在索引数组中的起始三角形
+    uint32_t triangleCount;
+    uint32_t vertexCount; // 引用的不同顶点数
+    float    radius;
+    Vec3f    center;
+};
+
+// 一级 LOD 的索引区间，和原网格共用顶点
+struct MeshLod {
+    uint32_t indexOffset; // 在 LOD 索引数组中的起始位置
+    uint32_t indexCount;
+};
+
+struct MeshBounds {
+    Vec3f min;
+    Vec3f max;
+};
+
+// 索引网格：去重后的交错顶点 + 32 位索引 + 包围盒 + meshlet
+// 数据可以来自 OBJ 构建，也可以直接映射二进制缓存文件，两种情况都通过 span 访问
+class Mesh {
+public:
+    static constexpr uint32_t MESHLET_MAX_VERTICES  = 64;
+    static constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+    static constexpr uint32_t LOD_MAX_LEVELS        = 8;
+    static constexpr uint32_t LOD_MIN_TRIANGLES     = 64;
+
+    Mesh() = default;
+
+    Mesh(const Mesh& other)            = delete;
+    Mesh& operator=(const Mesh& other) = delete;
+    Mesh(Mesh&& other) noexcept        = default;
+    Mesh& operator=(Mesh&& other) noexcept = default;
+
+public:
+    inline std::span<const MeshVertex> GetVertices() const { return m_vertices; }
+    inline std::span<const uint32_t>   GetIndices() const { return m_indices; }
+    inline std::span<const Meshlet>    GetMeshlets() const { return m_meshlets; }
+    inline const MeshBounds&           GetBounds() const { return m_bounds; }
+    inline bool                        IsMapped() const { return m_file.IsOpen(); }
+    inline const Vec3fSoA&             GetPositionStream() const { return m_positionStream; }
+    inline const Vec3fSoA&             GetNormalStream() const { return m_normalStream; }
+
+    // 第 0 级是完整网格，级别越高三角形越少
+    inline uint32_t GetLodCount() const { return 1 + (uint32_t)m_lods.size(); }
+    inline std::span<const uint32_t> GetLodIndices(uint32_t level) const {
+        if (level == 0 || m_lods.empty()) return m_indices;
+        const MeshLod& lod = m_lods[Min<size_t>(level, m_lods.size()) - 1];
+        return m_lodIndices.subspan(lod.indexOffset, lod.indexCount);
+    }
+
+    // 由 OBJ 数据构建：按 (v, vt, vn) 去重，缺失法线的顶点使用按面积加权的平滑法线
+    inline static Mesh Build(const ObjData& data) {
+        Mesh mesh;
+
+        std::vector<Vec3f> smoothNormals;
+        for (const auto& corner : data.corners) {
+            if (corner[2] < 0) {
+                smoothNormals.resize(data.positions.size());
+                break;
+            }
+        }
+        if (!smoothNormals.empty()) {
+            for (size_t i = 0; i < data.corners.size(); i += 3) {
+                const Vec3f& p0 = data.positions[data.corners[i][0]];
+                const Vec3f& p1 = data.positions[data.corners[i + 1][0]];
+                const Vec3f& p2 = data.positions[data.corners[i + 2][0]];
+                Vec3f        n  = vector_cross(p1 - p0, p2 - p0);
+                for (size_t j = 0; j < 3; j++)
+                    smoothNormals[data.corners[i + j][0]] += n;
+            }
+        }
+
+        struct CornerHash {
+            size_t operator()(const Vec3i& c) const {
+                uint64_t h = (uint32_t)c[0];
+                h          = h * 0x9E3779B97F4A7C15ull ^ (uint32_t)c[1];
+                h          = h * 0x9E3779B97F4A7C15ull ^ (uint32_t)c[2];
+                return (size_t)(h ^ (h >> 29));
+            }
+        };
+        std::unordered_map<Vec3i, uint32_t, CornerHash> remap;
+        remap.reserve(data.corners.size());
+        mesh.m_vertexStorage.reserve(data.positions.size());
+        mesh.m_indexStorage.reserve(data.corners.size());
+
+        for (const auto& corner : data.corners) {
+            auto [it, inserted] =
+                remap.try_emplace(corner, (uint32_t)mesh.m_vertexStorage.size());
+            if (inserted) {
+                MeshVertex vertex;
+                vertex.pos = data.positions[corner[0]];
+                Vec3f n    = corner[2] >= 0 ? data.normals[corner[2]] : smoothNormals[corner[0]];
+                float len  = vector_length(n);
+                vertex.normal = len > 0.0f ? n / len : Vec3f(0.0f, 0.0f, 1.0f);
+                vertex.uv     = corner[1] >= 0 ? data.uvs[corner[1]] : Vec2f();
+                mesh.m_vertexStorage.push_back(vertex);
+            }
+            mesh.m_indexStorage.push_back(it->second);
+        }
+
+        mesh.ComputeBounds();
+        mesh.BuildMeshlets();
+        mesh.BindStorage();
+        return mesh;
+    }
+
+    // 顶点缓存 / overdraw / 顶点读取顺序优化，只对自有存储生效（映射的缓存已经优化过）
+    inline MeshOptimizeReport Optimize() {
+        MeshOptimizeReport report;
+        if (m_vertexStorage.empty()) return report;
+        size_t       vertexCount = m_vertexStorage.size();
+        size_t       stride      = sizeof(MeshVertex) / sizeof(float);
+        const float* positions   = &m_vertexStorage[0].pos.x;
+
+        report.acmrBefore = MeshOptimizer::AnalyzeVertexCache(m_indexStorage, vertexCount);
+        report.overdrawBefore =
+            MeshOptimizer::AnalyzeOverdraw(m_indexStorage, positions, stride, vertexCount);
+
+        std::vector<uint32_t> clusters;
+        std::vector<uint32_t> indices =
+            MeshOptimizer::OptimizeVertexCache(m_indexStorage, vertexCount, &clusters);
+        indices = MeshOptimizer::OptimizeOverdraw(indices, clusters, positions, stride);
+        std::vector<uint32_t>   remap = MeshOptimizer::OptimizeVertexFetch(indices, vertexCount);
+        std::vector<MeshVertex> vertices(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertices[remap[v]] = m_vertexStorage[v];
+        m_vertexStorage = std::move(vertices);
+        m_indexStorage  = std::move(indices);
+        positions       = &m_vertexStorage[0].pos.x;
+        // 顶点重新编号后旧的 LOD 失效，需要重新生成
+        m_lodStorage.clear();
+        m_lodIndexStorage.clear();
+
+        report.acmrAfter = MeshOptimizer::AnalyzeVertexCache(m_indexStorage, vertexCount);
+        report.overdrawAfter =
+            MeshOptimizer::AnalyzeOverdraw(m_indexStorage, positions, stride, vertexCount);
+
+        BuildMeshlets();
+        BindStorage();
+        return report;
+    }
+
+    // 逐级把上一级简化到一半左右，直到三角形太少或无法继续简化
+    // 每一级重新做顶点缓存优化；只对自有存储生效
+    inline void BuildLods() {
+        m_lodStorage.clear();
+        m_lodIndexStorage.clear();
+        if (m_vertexStorage.empty()) return;
+        size_t       vertexCount = m_vertexStorage.size();
+        size_t       stride      = sizeof(MeshVertex) / sizeof(float);
+        const float* positions   = &m_vertexStorage[0].pos.x;
+
+        std::vector<uint32_t> current = m_indexStorage;
+        while (m_lodStorage.size() + 1 < LOD_MAX_LEVELS) {
+            size_t target = current.size() / 6 * 3;
+            if (target / 3 < LOD_MIN_TRIANGLES) break;
+            std::vector<uint32_t> lod =
+                MeshSimplifier::Simplify(current, positions, stride, vertexCount, target);
+            // 接缝锁定后减少不到 10% 就不再继续
+            if (lod.empty() || lod.size() * 10 > current.size() * 9) break;
+            lod = MeshOptimizer::OptimizeVertexCache(lod, vertexCount);
+            m_lodStorage.push_back({(uint32_t)m_lodIndexStorage.size(), (uint32_t)lod.size()});
+            m_lodIndexStorage.insert(m_lodIndexStorage.end(), lod.begin(), lod.end());
+            current = std::move(lod);
+        }
+        BindStorage();
+    }
+
+    // 从交错顶点拆出 SoA 的位置/法线流，供批量变换使用
+    inline void BuildStreams() {
+        std::span<const MeshVertex> vertices = m_vertices;
+        m_positionStream.resize(vertices.size());
+        m_normalStream.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            m_positionStream.x[i] = vertices[i].pos.x;
+            m_positionStream.y[i] = vertices[i].pos.y;
+            m_positionStream.z[i] = vertices[i].pos.z;
+            m_normalStream.x[i]   = vertices[i].normal.x;
+            m_normalStream.y[i]   = vertices[i].normal.y;
+            m_normalStream.z[i]   = vertices[i].normal.z;
+        }
+    }
+
+    // 根据当前索引顺序重新划分 meshlet
+    inline void BuildMeshlets() {
+        m_meshletStorage.clear();
+        std::span<const MeshVertex> vertices = CurrentVertices();
+        std::span<const uint32_t>   indices  = CurrentIndices();
+        std::vector<uint32_t>       stamp(vertices.size(), UINT32_MAX);
+
+        Meshlet current{0, 0, 0, 0.0f, Vec3f()};
+        auto    finish = [&]() {
+            if (current.triangleCount == 0) return;
+            Vec3f lo(1e30f, 1e30f, 1e30f), hi(-1e30f, -1e30f, -1e30f);
+            for (uint32_t i = 0; i < current.triangleCount * 3; i++) {
+                const Vec3f& p = vertices[indices[current.triangleOffset * 3 + i]].pos;
+                lo             = vector_min(lo, p);
+                hi             = vector_max(hi, p);
+            }
+            current.center = (lo + hi) * 0.5f;
+            float radius2  = 0.0f;
+            for (uint32_t i = 0; i < current.triangleCount * 3; i++) {
+                const Vec3f& p = vertices[indices[current.triangleOffset * 3 + i]].pos;
+                radius2        = Max(radius2, vector_length_square(p - current.center));
+            }
+            current.radius = sqrtf(radius2);
+            m_meshletStorage.push_back(current);
+        };
+
+        uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+        for (uint32_t t = 0; t < triangleCount; t++) {
+            uint32_t meshletId = (uint32_t)m_meshletStorage.size();
+            uint32_t newVerts  = 0;
+            for (uint32_t j = 0; j < 3; j++)
+                newVerts += stamp[indices[t * 3 + j]] != meshletId;
+            if (current.vertexCount + newVerts > MESHLET_MAX_VERTICES ||
+                current.triangleCount + 1 > MESHLET_MAX_TRIANGLES) {
+                finish();
+                meshletId = (uint32_t)m_meshletStorage.size();
+                current   = Meshlet{t, 0, 0, 0.0f, Vec3f()};
+            }
+            for (uint32_t j = 0; j < 3; j++) {
+                uint32_t v = indices[t * 3 + j];
+                if (stamp[v] != meshletId) {
+                    stamp[v] = meshletId;
+                    current.vertexCount++;
+                }
+            }
+            current.triangleCount++;
+        }
+        finish();
+        m_meshlets = m_meshletStorage;
+    }
+
+public:
+    // 缓存文件路径：源文件旁边加后缀
+    inline static std::string GetCachePath(const std::string& sourcePath) {
+        return sourcePath + ".meshcache";
+    }
+
+    // 尝试映射缓存文件，源文件的路径/大小/修改时间任一不匹配都视为失效
+    inline static bool LoadCache(const std::string& sourcePath, Mesh& mesh) {
+        CacheKey key;
+        if (!GetCacheKey(sourcePath, key)) return false;
+        MappedFile file(GetCachePath(sourcePath).c_str());
+        if (!file.IsOpen() || file.GetSize() < sizeof(CacheHeader)) return false;
+
+        const uint8_t* data = file.GetData();
+        size_t         size = file.GetSize();
+        CacheHeader    header;
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, CACHE_MAGIC, 4) != 0) return false;
+        if (header.version != CACHE_VERSION) return false;
+        if (header.sourceSize != key.size || header.sourceTime != key.time) return false;
+        if (header.pathLength != key.path.size()) return false;
+
+        auto inRange = [size](uint64_t offset, uint64_t bytes) {
+            return offset <= size && bytes <= size - offset;
+        };
+        if (!inRange(header.pathOffset, header.pathLength) ||
+            !inRange(header.vertexOffset, header.vertexCount * sizeof(MeshVertex)) ||
+            !inRange(header.indexOffset, header.indexCount * sizeof(uint32_t)) ||
+            !inRange(header.meshletOffset, header.meshletCount * sizeof(Meshlet)) ||
+            !inRange(header.lodOffset, header.lodCount * sizeof(MeshLod)) ||
+            !inRange(header.lodIndexOffset, header.lodIndexCount * sizeof(uint32_t)))
+            return false;
+        if (memcmp(data + header.pathOffset, key.path.data(), key.path.size()) != 0) return false;
+        for (uint32_t i = 0; i < header.lodCount; i++) {
+            MeshLod lod;
+            memcpy(&lod, data + header.lodOffset + i * sizeof(MeshLod), sizeof(lod));
+            if (lod.indexOffset > header.lodIndexCount ||
+                lod.indexCount > header.lodIndexCount - lod.indexOffset)
+                return false;
+        }
+
+        mesh.m_vertices = {reinterpret_cast<const MeshVertex*>(data + header.vertexOffset),
+                           header.vertexCount};
+        mesh.m_indices  = {reinterpret_cast<const uint32_t*>(data + header.indexOffset),
+                           header.indexCount};
+        mesh.m_meshlets = {reinterpret_cast<const Meshlet*>(data + header.meshletOffset),
+                           header.meshletCount};
+        mesh.m_lods     = {reinterpret_cast<const MeshLod*>(data + header.lodOffset),
+                           header.lodCount};
+        mesh.m_lodIndices = {reinterpret_cast<const uint32_t*>(data + header.lodIndexOffset),
+                             header.lodIndexCount};
+        mesh.m_bounds   = {Vec3f(header.boundsMin), Vec3f(header.boundsMax)};
+        mesh.m_file     = std::move(file);
+        return true;
+    }
+
+    // 写入缓存文件，先写临时文件再改名，避免其他进程读到写了一半的文件
+    inline bool SaveCache(const std::string& sourcePath) const {
+        CacheKey key;
+        if (!GetCacheKey(sourcePath, key)) return false;
+
+        CacheHeader header;
+        memcpy(header.magic, CACHE_MAGIC, 4);
+        header.version      = CACHE_VERSION;
+        header.sourceSize   = key.size;
+        header.sourceTime   = key.time;
+        header.pathLength   = (uint32_t)key.path.size();
+        header.vertexCount  = (uint32_t)m_vertices.size();
+        header.indexCount   = (uint32_t)m_indices.size();
+        header.meshletCount = (uint32_t)m_meshlets.size();
+        header.lodCount     = (uint32_t)m_lods.size();
+        header.lodIndexCount = (uint32_t)m_lodIndices.size();
+        for (int i = 0; i < 3; i++) {
+            header.boundsMin[i] = m_bounds.min[i];
+            header.boundsMax[i] = m_bounds.max[i];
+        }
+
+        uint64_t offset      = AlignOffset(sizeof(CacheHeader));
+        header.vertexOffset  = offset;
+        offset               = AlignOffset(offset + m_vertices.size_bytes());
+        header.indexOffset   = offset;
+        offset               = AlignOffset(offset + m_indices.size_bytes());
+        header.meshletOffset = offset;
+        offset               = AlignOffset(offset + m_meshlets.size_bytes());
+        header.lodOffset     = offset;
+        offset               = AlignOffset(offset + m_lods.size_bytes());
+        header.lodIndexOffset = offset;
+        offset               = AlignOffset(offset + m_lodIndices.size_bytes());
+        header.pathOffset    = offset;
+
+        std::string cachePath = GetCachePath(sourcePath);
+        std::string tempPath  = cachePath + ".tmp";
+        FILE*       fp        = fopen(tempPath.c_str(), "wb");
+        if (fp == NULL) return false;
+        bool ok = true;
+        auto put = [&](uint64_t at, const void* bytes, size_t count) {
+            if (!ok) return;
+            ok = fseek(fp, (long)at, SEEK_SET) == 0;
+            if (ok && count > 0) ok = fwrite(bytes, 1, count, fp) == count;
+        };
+        put(0, &header, sizeof(header));
+        put(header.vertexOffset, m_vertices.data(), m_vertices.size_bytes());
+        put(header.indexOffset, m_indices.data(), m_indices.size_bytes());
+        put(header.meshletOffset, m_meshlets.data(), m_meshlets.size_bytes());
+        put(header.lodOffset, m_lods.data(), m_lods.size_bytes());
+        put(header.lodIndexOffset, m_lodIndices.data(), m_lodIndices.size_bytes());
+        put(header.pathOffset, key.path.data(), key.path.size());
+        ok &= fclose(fp) == 0;
+
+        std::error_code ec;
+        if (ok) std::filesystem::rename(tempPath, cachePath, ec);
+        if (!ok || ec) {
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    static constexpr char     CACHE_MAGIC[4] = {'S', 'R', 'M', 'C'};
+    static constexpr uint32_t CACHE_VERSION  = 3;
+
+    struct CacheHeader {
+        char     magic[4];
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t  sourceTime;
+        uint32_t pathLength;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t meshletCount;
+        uint32_t lodCount;
+        uint32_t lodIndexCount;
+        float    boundsMin[3];
+        float    boundsMax[3];
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t meshletOffset;
+        uint64_t lodOffset;
+        uint64_t lodIndexOffset;
+        uint64_t pathOffset;
+    };
+
+    struct CacheKey {
+        std::string path;
+        uint64_t    size{0};
+        int64_t     time{0};
+    };
+
+    inline static uint64_t AlignOffset(uint64_t offset) { return (offset + 15) & ~(uint64_t)15; }
+
+    inline static bool GetCacheKey(const std::string& sourcePath, CacheKey& key) {
+        std::error_code ec;
+        auto            path = std::filesystem::absolute(sourcePath, ec);
+        if (ec) return false;
+        key.size = std::filesystem::file_size(path, ec);
+        if (ec) return false;
+        auto time = std::filesystem::last_write_time(path, ec);
+        if (ec) return false;
+        key.time = (int64_t)time.time_since_epoch().count();
+        key.path = path.lexically_normal().string();
+        return true;
+    }
+
+    // 没有映射文件时，span 指向自有的存储
+    inline std::span<const MeshVertex> CurrentVertices() const {
+        return m_vertexStorage.empty() ? m_vertices : std::span<const MeshVertex>(m_vertexStorage);
+    }
+    inline std::span<const uint32_t> CurrentIndices() const {
+        return m_indexStorage.empty() ? m_indices : std::span<const uint32_t>(m_indexStorage);
+    }
+
+    inline void BindStorage() {
+        m_vertices = m_vertexStorage;
+        m_indices  = m_indexStorage;
+        m_meshlets = m_meshletStorage;
+        m_lods       = m_lodStorage;
+        m_lodIndices = m_lodIndexStorage;
+    }
+
+    inline void ComputeBounds() {
+        m_bounds = {Vec3f(1e30f, 1e30f, 1e30f), Vec3f(-1e30f, -1e30f, -1e30f)};
+        for (const auto& v : m_vertexStorage) {
+            m_bounds.min = vector_min(m_bounds.min, v.pos);
+            m_bounds.max = vector_max(m_bounds.max, v.pos);
+        }
+        if (m_vertexStorage.empty()) m_bounds = {Vec3f(), Vec3f()};
+    }
+
+protected:
+    std::vector<MeshVertex>     m_vertexStorage;
+    std::vector<uint32_t>       m_indexStorage;
+    std::vector<Meshlet>        m_meshletStorage;
+    std::vector<MeshLod>        m_lodStorage;
+    std::vector<uint32_t>       m_lodIndexStorage;
+    std::span<const MeshVertex> m_vertices;
+    std::span<const uint32_t>   m_indices;
+    std::span<const Meshlet>    m_meshlets;
+    std::span<const MeshLod>    m_lods;
+    std::span<const uint32_t>   m_lodIndices;
+    MeshBounds                  m_bounds;
+    Vec3fSoA                    m_positionStream;
+    Vec3fSoA                    m_normalStream;
+    MappedFile                  m_file;
+};
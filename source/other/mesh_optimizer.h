@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include "math.h"
+
+// 网格优化前后的统计
+struct MeshOptimizeReport {
+    float acmrBefore{0.0f};     // 每个三角形平均的顶点缓存未命中数
+    float acmrAfter{0.0f};
+    float overdrawBefore{1.0f}; // 着色次数 / 覆盖像素数
+    float overdrawAfter{1.0f};
+};
+
+// 三角形/顶点重排：
+// 1. Tipsify 顶点缓存优化，同时在无路可走（dead end）处切分出簇
+// 2. 按簇的遮挡潜力排序，让朝外、靠外的簇先画，减少 overdraw
+// 3. 顶点按首次使用的顺序重新编号，提高顶点读取的局部性
+// 顶点位置通过 (positions, stride) 传入，stride 以 float 为单位
+class MeshOptimizer {
+public:
+    static constexpr uint32_t CACHE_SIZE = 16;
+
+    // Tipsify，返回新的索引顺序，clusters 输出每个簇的起始三角形
+    static std::vector<uint32_t> OptimizeVertexCache(std::span<const uint32_t> indices,
+                                                     size_t                    vertexCount,
+                                                     std::vector<uint32_t>*    clusters = nullptr,
+                                                     uint32_t cacheSize = CACHE_SIZE) {
+        size_t                triangleCount = indices.size() / 3;
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        if (clusters) clusters->clear();
+        if (triangleCount == 0) return result;
+
+        // 顶点 -> 相邻三角形
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t v : indices)
+            offsets[v + 1]++;
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (size_t j = 0; j < 3; j++)
+                adjacency[fill[indices[t * 3 + j]]++] = (uint32_t)t;
+        }
+
+        std::vector<uint32_t> live(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            live[v] = offsets[v + 1] - offsets[v];
+        std::vector<uint32_t> timestamp(vertexCount, 0);
+        std::vector<bool>     emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd;
+        std::vector<uint32_t> candidates;
+        uint32_t              time   = cacheSize + 1;
+        size_t                cursor = 0;
+
+        // 找第一个被使用的顶点
+        auto nextLiveVertex = [&]() -> int64_t {
+            while (!deadEnd.empty()) {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) return v;
+            }
+            for (; cursor < vertexCount; cursor++) {
+                if (live[cursor] > 0) return (int64_t)cursor++;
+            }
+            return -1;
+        };
+
+        int64_t fan = nextLiveVertex();
+        if (clusters) clusters->push_back(0);
+        while (fan >= 0) {
+            candidates.clear();
+            for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+                uint32_t t = adjacency[k];
+                if (emitted[t]) continue;
+                for (size_t j = 0; j < 3; j++) {
+                    uint32_t v = indices[t * 3 + j];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - timestamp[v] > cacheSize) timestamp[v] = time++;
+                }
+                emitted[t] = true;
+            }
+
+            // 优先选仍在缓存中、且剩余三角形能在被挤出前处理完的顶点
+            int64_t best     = -1;
+            int64_t priority = -1;
+            for (uint32_t v : candidates) {
+                if (live[v] == 0) continue;
+                int64_t p = 0;
+                if (time - timestamp[v] + 2 * live[v] <= cacheSize) p = time - timestamp[v];
+                if (p > priority) {
+                    priority = p;
+                    best     = v;
+                }
+            }
+            if (best < 0) {
+                best = nextLiveVertex();
+                if (best >= 0 && clusters && result.size() / 3 < triangleCount)
+                    clusters->push_back((uint32_t)(result.size() / 3));
+            }
+            fan = best;
+        }
+        return result;
+    }
+
+    // 按簇的遮挡潜力 dot(簇中心 - 网格中心, 簇法线) 从大到小排序
+    static std::vector<uint32_t> OptimizeOverdraw(std::span<const uint32_t> indices,
+                                                  std::span<const uint32_t> clusters,
+                                                  const float* positions, size_t stride) {
+        size_t triangleCount = indices.size() / 3;
+        if (clusters.size() <= 1) return {indices.begin(), indices.end()};
+
+        auto position = [&](uint32_t v) { return Vec3f(positions + v * stride); };
+
+        Vec3f meshCenter;
+        float meshArea = 0.0f;
+        struct Cluster {
+            uint32_t begin, end;
+            float    sortKey;
+        };
+        std::vector<Cluster> sorted;
+        std::vector<Vec3f>   centers;
+        std::vector<Vec3f>   normals;
+        for (size_t c = 0; c < clusters.size(); c++) {
+            uint32_t begin = clusters[c];
+            uint32_t end   = c + 1 < clusters.size() ? clusters[c + 1] : (uint32_t)triangleCount;
+            Vec3f    center, normal;
+            float    area = 0.0f;
+            for (uint32_t t = begin; t < end; t++) {
+                Vec3f p0 = position(indices[t * 3 + 0]);
+                Vec3f p1 = position(indices[t * 3 + 1]);
+                Vec3f p2 = position(indices[t * 3 + 2]);
+                Vec3f n  = vector_cross(p1 - p0, p2 - p0);
+                float a  = vector_length(n);
+                center += (p0 + p1 + p2) * (a / 3.0f);
+                normal += n;
+                area += a;
+            }
+            meshCenter += center;
+            meshArea += area;
+            centers.push_back(area > 0.0f ? center / area : position(indices[begin * 3]));
+            float len = vector_length(normal);
+            normals.push_back(len > 0.0f ? normal / len : Vec3f());
+            sorted.push_back({begin, end, 0.0f});
+        }
+        if (meshArea > 0.0f) meshCenter = meshCenter / meshArea;
+        for (size_t c = 0; c < sorted.size(); c++)
+            sorted[c].sortKey = vector_dot(centers[c] - meshCenter, normals[c]);
+        std::stable_sort(sorted.begin(), sorted.end(),
+                         [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (const auto& cluster : sorted)
+            result.insert(result.end(), indices.begin() + cluster.begin * 3,
+                          indices.begin() + cluster.end * 3);
+        return result;
+    }
+
+    // 顶点按首次被索引的顺序重新编号，indices 原地改写，返回 remap[旧编号] = 新编号
+    // 没有被引用的顶点排在最后
+    static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices,
+                                                     size_t                 vertexCount) {
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        uint32_t              next = 0;
+        for (uint32_t& v : indices) {
+            if (remap[v] == UINT32_MAX) remap[v] = next++;
+            v = remap[v];
+        }
+        for (auto& r : remap) {
+            if (r == UINT32_MAX) r = next++;
+        }
+        return remap;
+    }
+
+    // FIFO 顶点缓存模拟，返回 ACMR
+    static float AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+                                    uint32_t cacheSize = CACHE_SIZE) {
+        if (indices.empty()) return 0.0f;
+        std::vector<uint32_t> timestamp(vertexCount, 0);
+        uint32_t              time   = cacheSize + 1;
+        size_t                misses = 0;
+        for (uint32_t v : indices) {
+            if (time - timestamp[v] > cacheSize) {
+                timestamp[v] = time++;
+                misses++;
+            }
+        }
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    // 从 ±X/±Y/±Z 六个方向做正交投影光栅化，统计通过深度测试的片元数 / 覆盖像素数
+    static float AnalyzeOverdraw(std::span<const uint32_t> indices, const float* positions,
+                                 size_t stride, size_t vertexCount, int gridSize = 256) {
+        if (indices.empty() || vertexCount == 0) return 1.0f;
+        Vec3f lo(1e30f, 1e30f, 1e30f), hi(-1e30f, -1e30f, -1e30f);
+        for (size_t v = 0; v < vertexCount; v++) {
+            Vec3f p(positions + v * stride);
+            lo = vector_min(lo, p);
+            hi = vector_max(hi, p);
+        }
+        float extent = Max(Max(hi.x - lo.x, hi.y - lo.y), Max(hi.z - lo.z, 1e-6f));
+        float scale  = (gridSize - 1) / extent;
+
+        std::vector<float> depth(gridSize * gridSize);
+        size_t             shaded = 0, covered = 0;
+        for (int axis = 0; axis < 3; axis++) {
+            for (int sign = -1; sign <= 1; sign += 2) {
+                std::fill(depth.begin(), depth.end(), -1e30f);
+                int ax = (axis + 1) % 3, ay = (axis + 2) % 3;
+                for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+                    Vec3f p[3];
+                    for (int j = 0; j < 3; j++) {
+                        Vec3f v(positions + indices[t + j] * stride);
+                        p[j] = Vec3f((v[ax] - lo[ax]) * scale, (v[ay] - lo[ay]) * scale,
+                                     (v[axis] - lo[axis]) * sign);
+                    }
+                    shaded += RasterizeOverdraw(p, depth.data(), gridSize);
+                }
+                for (float d : depth)
+                    covered += d > -1e30f;
+            }
+        }
+        return covered ? (float)shaded / (float)covered : 1.0f;
+    }
+
+protected:
+    // 返回通过深度测试的像素数，深度值越大越近
+    static size_t RasterizeOverdraw(const Vec3f p[3], float* depth, int gridSize) {
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+        if (area == 0.0f) return 0;
+        int minX = Max(0, (int)floorf(Min(p[0].x, Min(p[1].x, p[2].x))));
+        int maxX = Min(gridSize - 1, (int)ceilf(Max(p[0].x, Max(p[1].x, p[2].x))));
+        int minY = Max(0, (int)floorf(Min(p[0].y, Min(p[1].y, p[2].y))));
+        int maxY = Min(gridSize - 1, (int)ceilf(Max(p[0].y, Max(p[1].y, p[2].y))));
+        size_t passed = 0;
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                float px = x + 0.5f, py = y + 0.5f;
+                float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+                float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+                float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+                if (area < 0.0f) w0 = -w0, w1 = -w1, w2 = -w2;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+                float  z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / Abs(area);
+                float& d = depth[y * gridSize + x];
+                if (z <= d) continue;
+                d = z;
+                passed++;
+            }
+        }
+        return passed;
+    }
+};
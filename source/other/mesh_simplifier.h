@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "math.h"
+
+// 基于二次误差度量（QEM）的网格简化
+// 使用半边折叠：被删除的顶点并入相邻的已有顶点，因此简化结果只是新的索引数组，和原网格共用顶点
+// 同一位置存在多个顶点（UV/法线接缝）或位于开放边界上的顶点被锁定，不会被折叠掉，以保持接缝
+class MeshSimplifier {
+public:
+    // 简化到 targetIndexCount 个索引以内，无法继续折叠时提前返回
+    // resultError 输出最大的折叠误差（距离的平方）
+    static std::vector<uint32_t> Simplify(std::span<const uint32_t> indices, const float* positions,
+                                          size_t stride, size_t vertexCount,
+                                          size_t targetIndexCount, float* resultError = nullptr) {
+        std::vector<uint32_t> result(indices.begin(), indices.end());
+        if (resultError) *resultError = 0.0f;
+        if (result.size() <= targetIndexCount || vertexCount == 0) return result;
+
+        auto position = [&](uint32_t v) { return Vec3f(positions + v * stride); };
+
+        // 位置相同的顶点映射到同一个代表顶点
+        std::vector<uint32_t> positionId(vertexCount);
+        {
+            struct PositionHash {
+                size_t operator()(const Vec3f& p) const {
+                    uint32_t h[3];
+                    memcpy(h, p.m, sizeof(h));
+                    return (size_t)(h[0] * 73856093u ^ h[1] * 19349663u ^ h[2] * 83492791u);
+                }
+            };
+            std::unordered_map<Vec3f, uint32_t, PositionHash> table;
+            table.reserve(vertexCount);
+            for (uint32_t v = 0; v < vertexCount; v++)
+                positionId[v] = table.try_emplace(position(v), v).first->second;
+        }
+
+        // 锁定接缝顶点与边界顶点
+        std::vector<uint8_t>  locked(vertexCount, 0);
+        std::vector<uint32_t> wedgeCount(vertexCount, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+            wedgeCount[positionId[v]]++;
+        for (uint32_t v = 0; v < vertexCount; v++)
+            locked[v] = wedgeCount[positionId[v]] > 1;
+        {
+            // 按位置统计边的使用次数，只被一个三角形使用的边是开放边界
+            std::unordered_map<uint64_t, uint32_t> edges;
+            edges.reserve(result.size());
+            auto edgeKey = [&](uint32_t a, uint32_t b) {
+                a = positionId[a], b = positionId[b];
+                if (a > b) std::swap(a, b);
+                return ((uint64_t)a << 32) | b;
+            };
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int j = 0; j < 3; j++)
+                    edges[edgeKey(result[i + j], result[i + (j + 1) % 3])]++;
+            }
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    uint32_t a = result[i + j], b = result[i + (j + 1) % 3];
+                    if (edges[edgeKey(a, b)] == 1) locked[a] = locked[b] = 1;
+                }
+            }
+        }
+
+        // 每个顶点的误差二次型：相邻三角形平面的面积加权和
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.size(); i += 3) {
+            Vec3f p0 = position(result[i]), p1 = position(result[i + 1]),
+                  p2 = position(result[i + 2]);
+            Vec3f n    = vector_cross(p1 - p0, p2 - p0);
+            float area = vector_length(n);
+            if (area == 0.0f) continue;
+            n         = n / area;
+            Quadric q = Quadric::FromPlane(n, -vector_dot(n, p0), area);
+            for (int j = 0; j < 3; j++)
+                quadrics[result[i + j]] += q;
+        }
+
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<uint8_t>  touched(vertexCount);
+        std::vector<uint32_t> offsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        float                 maxError = 0.0f;
+
+        while (result.size() > targetIndexCount) {
+            // 顶点 -> 相邻三角形
+            std::fill(offsets.begin(), offsets.end(), 0);
+            for (uint32_t v : result)
+                offsets[v + 1]++;
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            adjacency.resize(result.size());
+            {
+                std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+                for (size_t i = 0; i < result.size(); i++)
+                    adjacency[fill[result[i]]++] = (uint32_t)(i / 3);
+            }
+
+            // 候选折叠 v -> u，v 必须未锁定
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    uint32_t v = result[i + j];
+                    for (int k = 1; k < 3; k++) {
+                        uint32_t u = result[i + (j + k) % 3];
+                        if (locked[v] || positionId[u] == positionId[v]) continue;
+                        collapses.push_back({v, u, quadrics[v].Evaluate(position(u))});
+                    }
+                }
+            }
+            if (collapses.empty()) break;
+            std::sort(collapses.begin(), collapses.end(),
+                      [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+            // 每轮每个顶点最多参与一次折叠，每次折叠大约删除两个三角形
+            std::iota(remap.begin(), remap.end(), 0);
+            std::fill(touched.begin(), touched.end(), 0);
+            size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+            size_t removed = 0, applied = 0;
+            for (const auto& c : collapses) {
+                if (removed >= trianglesToRemove) break;
+                if (touched[c.from] || touched[c.to]) continue;
+                if (!IsCollapseValid(c.from, c.to, result, offsets, adjacency, positions, stride))
+                    continue;
+                remap[c.from] = c.to;
+                quadrics[c.to] += quadrics[c.from];
+                maxError = Max(maxError, c.error);
+                // 锁定被影响的一圈顶点，保证本轮的翻转检查仍然有效
+                for (uint32_t k = offsets[c.from]; k < offsets[c.from + 1]; k++) {
+                    uint32_t t = adjacency[k];
+                    for (int j = 0; j < 3; j++)
+                        touched[result[t * 3 + j]] = 1;
+                    removed += IsEdgeOfTriangle(result, t, c.from, c.to);
+                }
+                applied++;
+            }
+            if (applied == 0) break;
+
+            // 重写索引并删除退化三角形
+            size_t count = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+                if (positionId[a] == positionId[b] || positionId[b] == positionId[c] ||
+                    positionId[c] == positionId[a])
+                    continue;
+                result[count++] = a;
+                result[count++] = b;
+                result[count++] = c;
+            }
+            result.resize(count);
+        }
+        if (resultError) *resultError = maxError;
+        return result;
+    }
+
+protected:
+    // 对称 4x4 二次型，只存上三角
+    struct Quadric {
+        float a00{0}, a01{0}, a02{0}, a11{0}, a12{0}, a22{0};
+        float b0{0}, b1{0}, b2{0};
+        float c{0};
+
+        static Quadric FromPlane(const Vec3f& n, float d, float weight) {
+            Quadric q;
+            q.a00 = n.x * n.x * weight;
+            q.a01 = n.x * n.y * weight;
+            q.a02 = n.x * n.z * weight;
+            q.a11 = n.y * n.y * weight;
+            q.a12 = n.y * n.z * weight;
+            q.a22 = n.z * n.z * weight;
+            q.b0  = n.x * d * weight;
+            q.b1  = n.y * d * weight;
+            q.b2  = n.z * d * weight;
+            q.c   = d * d * weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o) {
+            a00 += o.a00, a01 += o.a01, a02 += o.a02;
+            a11 += o.a11, a12 += o.a12, a22 += o.a22;
+            b0 += o.b0, b1 += o.b1, b2 += o.b2;
+            c += o.c;
+            return *this;
+        }
+
+        // = p^T A p + 2 b^T p + c
+        float Evaluate(const Vec3f& p) const {
+            float rx = a00 * p.x + a01 * p.y + a02 * p.z;
+            float ry = a01 * p.x + a11 * p.y + a12 * p.z;
+            float rz = a02 * p.x + a12 * p.y + a22 * p.z;
+            float e  = rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+            return Abs(e);
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float    error;
+    };
+
+    static bool IsEdgeOfTriangle(const std::vector<uint32_t>& indices, uint32_t t, uint32_t a,
+                                 uint32_t b) {
+        bool hasA = false, hasB = false;
+        for (int j = 0; j < 3; j++) {
+            hasA |= indices[t * 3 + j] == a;
+            hasB |= indices[t * 3 + j] == b;
+        }
+        return hasA && hasB;
+    }
+
+    // 折叠后 from 周围不含 to 的三角形不能翻转或退化成一条线
+    static bool IsCollapseValid(uint32_t from, uint32_t to, const std::vector<uint32_t>& indices,
+                                const std::vector<uint32_t>& offsets,
+                                const std::vector<uint32_t>& adjacency, const float* positions,
+                                size_t stride) {
+        auto  position = [&](uint32_t v) { return Vec3f(positions + v * stride); };
+        Vec3f target   = position(to);
+        for (uint32_t k = offsets[from]; k < offsets[from + 1]; k++) {
+            uint32_t t = adjacency[k];
+            if (IsEdgeOfTriangle(indices, t, from, to)) continue;
+            Vec3f before[3], after[3];
+            for (int j = 0; j < 3; j++) {
+                uint32_t v = indices[t * 3 + j];
+                before[j]  = position(v);
+                after[j]   = v == from ? target : before[j];
+            }
+            Vec3f n0 = vector_cross(before[1] - before[0], before[2] - before[0]);
+            Vec3f n1 = vector_cross(after[1] - after[0], after[2] - after[0]);
+            float l0 = vector_length(n0), l1 = vector_length(n1);
+            if (l1 <= 1e-12f) return false;
+            if (l0 > 0.0f && vector_dot(n0, n1) < 0.25f * l0 * l1) return false;
+        }
+        return true;
+    }
+};
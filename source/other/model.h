@@ -4,12 +4,19 @@
 
 #pragma once
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <span>
 
 #include "bitmap.h"
+#include "compressed_bitmap.h"
 #include "math.h"
+#include "mesh.h"
+#include "obj_parser.h"
+#include "thread_pool.h"
+
+class ModelHandle;
 
 class Model {
 public:
@@ -19,126 +26,264 @@ public:
         if (m_diffusemap) delete m_diffusemap;
         if (m_normalmap) delete m_normalmap;
         if (m_specularmap) delete m_specularmap;
+        if (m_diffusebc) delete m_diffusebc;
+        if (m_normalbc) delete m_normalbc;
+        if (m_specularbc) delete m_specularbc;
     }
 
-    inline Model(const char* filename) {
-        m_diffusemap  = NULL;
-        m_normalmap   = NULL;
-        m_specularmap = NULL;
-        std::ifstream in;
-        in.open(filename, std::ifstream::in);
-        if (in.fail()) return;
-        std::string line;
-        while (!in.eof()) {
-            std::getline(in, line);
-            std::istringstream iss(line.c_str());
-            char               trash;
-            if (line.compare(0, 2, "v ") == 0) {
-                iss >> trash;
-                Vec3f v;
-                for (int i = 0; i < 3; i++)
-                    iss >> v[i];
-                m_verts.push_back(v);
-            } else if (line.compare(0, 3, "vn ") == 0) {
-                iss >> trash >> trash;
-                Vec3f n;
-                for (int i = 0; i < 3; i++)
-                    iss >> n[i];
-                m_norms.push_back(n);
-            } else if (line.compare(0, 3, "vt ") == 0) {
-                iss >> trash >> trash;
-                Vec2f uv;
-                iss >> uv[0] >> uv[1];
-                m_uv.push_back(uv);
-            } else if (line.compare(0, 2, "f ") == 0) {
-                std::vector<Vec3i> f;
-                Vec3i              tmp;
-                iss >> trash;
-                while (iss >> tmp[0] >> trash >> tmp[1] >> trash >> tmp[2]) {
-                    for (int i = 0; i < 3; i++)
-                        tmp[i]--;
-                    f.push_back(tmp);
-                }
-                m_faces.push_back(f);
-            }
-        }
-        std::cout << "# v# " << m_verts.size() << " f# " << m_faces.size() << "\n";
+    // compressTextures 为 true 时纹理在加载后编码成块压缩格式，原始数据随即释放
+    inline Model(const char* filename, bool compressTextures = false) {
+        if (!LoadGeometry(filename)) return;
         m_diffusemap  = load_texture(filename, "_diffuse.bmp");
         m_normalmap   = load_texture(filename, "_nm.bmp");
         m_specularmap = load_texture(filename, "_spec.bmp");
+        if (compressTextures) CompressTextures();
     }
 
+    // 异步加载：几何与三张纹理作为独立任务提交到线程池并行加载
+    static ModelHandle LoadAsync(const std::string& filename, bool compressTextures = false,
+                                 ThreadPool& pool = ThreadPool::Instance());
+
     Model(Model&& other) noexcept {
-        other.m_diffusemap  = m_diffusemap;
-        other.m_specularmap = m_specularmap;
-        other.m_normalmap   = m_normalmap;
+        m_diffusemap  = other.m_diffusemap;
+        m_specularmap = other.m_specularmap;
+        m_normalmap   = other.m_normalmap;
+        m_diffusebc   = other.m_diffusebc;
+        m_normalbc    = other.m_normalbc;
+        m_specularbc  = other.m_specularbc;
+
+        m_mesh = std::move(other.m_mesh);
+
+        other.m_diffusemap  = nullptr;
+        other.m_normalmap   = nullptr;
+        other.m_specularmap = nullptr;
+        other.m_diffusebc   = nullptr;
+        other.m_normalbc    = nullptr;
+        other.m_specularbc  = nullptr;
+    }
+
+    // 将已加载的纹理编码为块压缩格式：漫反射 BC1，高光 BC4
+    // diablo3 的法线贴图是模型空间的（z 可以为负），无法用 BC5 重建 z，因此也用 BC1
+    inline void CompressTextures() {
+        if (m_diffusemap) {
+            m_diffusebc = new CompressedBitmap(*m_diffusemap, DIFFUSE_FORMAT);
+            delete m_diffusemap;
+            m_diffusemap = NULL;
+        }
+        if (m_normalmap) {
+            m_normalbc = new CompressedBitmap(*m_normalmap, NORMAL_FORMAT);
+            delete m_normalmap;
+            m_normalmap = NULL;
+        }
+        if (m_specularmap) {
+            m_specularbc = new CompressedBitmap(*m_specularmap, SPECULAR_FORMAT);
+            delete m_specularmap;
+            m_specularmap = NULL;
+        }
+    }
+
+protected:
+    friend class ModelHandle;
+
+    static constexpr BlockFormat DIFFUSE_FORMAT  = BlockFormat::BC1;
+    static constexpr BlockFormat NORMAL_FORMAT   = BlockFormat::BC1;
+    static constexpr BlockFormat SPECULAR_FORMAT = BlockFormat::BC4;
+
+    // 单张纹理的加载结果，压缩时只保留 compressed
+    struct TextureAsset {
+        std::unique_ptr<Bitmap>           bitmap;
+        std::unique_ptr<CompressedBitmap> compressed;
+    };
 
-        other.m_faces = std::move(m_faces);
-        other.m_verts = std::move(m_verts);
-        other.m_norms = std::move(m_norms);
-        other.m_uv    = std::move(m_uv);
+    Model() = default;
 
-        m_diffusemap  = nullptr;
-        m_normalmap   = nullptr;
-        m_specularmap = nullptr;
+    inline static TextureAsset load_texture_asset(const std::string& filename, const char* suffix,
+                                                  bool compress, BlockFormat format) {
+        TextureAsset asset;
+        asset.bitmap.reset(load_texture(filename, suffix));
+        if (compress && asset.bitmap) {
+            asset.compressed = std::make_unique<CompressedBitmap>(*asset.bitmap, format);
+            asset.bitmap.reset();
+        }
+        return asset;
+    }
+
+    inline void attach_textures(TextureAsset diffuse, TextureAsset normal, TextureAsset specular) {
+        m_diffusemap  = diffuse.bitmap.release();
+        m_diffusebc   = diffuse.compressed.release();
+        m_normalmap   = normal.bitmap.release();
+        m_normalbc    = normal.compressed.release();
+        m_specularmap = specular.bitmap.release();
+        m_specularbc  = specular.compressed.release();
+    }
+
+    // 优先映射二进制网格缓存，缓存失效时解析 OBJ 并重新写入缓存
+    inline bool LoadGeometry(const char* filename) {
+        Mesh mesh;
+        bool cached = Mesh::LoadCache(filename, mesh);
+        if (!cached) {
+            ObjData data;
+            if (!ObjParser::Parse(filename, data)) return false;
+            mesh                      = Mesh::Build(data);
+            MeshOptimizeReport report = mesh.Optimize();
+            std::cout << "# acmr " << report.acmrBefore << " -> " << report.acmrAfter
+                      << " overdraw " << report.overdrawBefore << " -> " << report.overdrawAfter
+                      << "\n";
+            mesh.BuildLods();
+            mesh.SaveCache(filename);
+        }
+        m_mesh = std::move(mesh);
+        m_mesh.BuildStreams();
+        std::cout << "# v# " << nverts() << " f# " << nfaces()
+                  << (cached ? " (mesh cache)" : "") << "\n";
+        std::cout << "# lod f#";
+        for (uint32_t level = 0; level < lodCount(); level++)
+            std::cout << " " << indices(level).size() / 3;
+        std::cout << "\n";
+        return true;
     }
 
 public:
-    inline int              nverts() const { return (int)m_verts.size(); }
-    inline int              nfaces() const { return (int)m_faces.size(); }
+    inline int              nverts() const { return (int)m_mesh.GetVertices().size(); }
+    inline int              nfaces() const { return (int)m_mesh.GetIndices().size() / 3; }
     inline std::vector<int> face(int idx) const {
         std::vector<int> face;
-        for (int i = 0; i < (int)m_faces[idx].size(); i++)
-            face.push_back(m_faces[idx][i][0]);
+        for (int i = 0; i < 3; i++)
+            face.push_back((int)m_mesh.GetIndices()[idx * 3 + i]);
         return face;
     }
 
-    inline Vec3f vert(int i) const { return m_verts[i]; }
-    inline Vec3f vert(int iface, int nthvert) const { return m_verts[m_faces[iface][nthvert][0]]; }
+    // 去重后的交错顶点与三角形索引，按顺序遍历即可访问整个网格
+    inline std::span<const MeshVertex> vertices() const { return m_mesh.GetVertices(); }
+    inline std::span<const uint32_t>   indices() const { return m_mesh.GetIndices(); }
+    // 简化后的索引，和 vertices() 共用顶点，level 越大三角形越少
+    inline uint32_t                  lodCount() const { return m_mesh.GetLodCount(); }
+    inline std::span<const uint32_t> indices(uint32_t level) const {
+        return m_mesh.GetLodIndices(level);
+    }
+    inline std::span<const Meshlet>    meshlets() const { return m_mesh.GetMeshlets(); }
+    inline const MeshBounds&           bounds() const { return m_mesh.GetBounds(); }
+    // SoA 排列的顶点位置/法线，和 vertices() 一一对应
+    inline const Vec3fSoA& positionStream() const { return m_mesh.GetPositionStream(); }
+    inline const Vec3fSoA& normalStream() const { return m_mesh.GetNormalStream(); }
 
-    inline Vec2f uv(int iface, int nthvert) const { return m_uv[m_faces[iface][nthvert][1]]; }
+    inline Vec3f vert(int i) const { return m_mesh.GetVertices()[i].pos; }
+    inline Vec3f vert(int iface, int nthvert) const { return corner(iface, nthvert).pos; }
 
-    inline Vec3f normal(int iface, int nthvert) const {
-        int idx = m_faces[iface][nthvert][2];
-        return vector_normalize(m_norms[idx]);
-    }
+    inline Vec2f uv(int iface, int nthvert) const { return corner(iface, nthvert).uv; }
+
+    // 法线在构建网格时已经归一化
+    inline Vec3f normal(int iface, int nthvert) const { return corner(iface, nthvert).normal; }
 
     inline Vec4f diffuse(Vec2f uv) const {
+        if (m_diffusebc) return m_diffusebc->Sample2D(uv);
         assert(m_diffusemap);
         return m_diffusemap->Sample2D(uv);
     }
 
     inline Vec3f normal(Vec2f uv) const {
-        assert(m_normalmap);
-        Vec4f color = m_normalmap->Sample2D(uv);
+        assert(m_normalmap || m_normalbc);
+        Vec4f color = m_normalbc ? m_normalbc->Sample2D(uv) : m_normalmap->Sample2D(uv);
         for (int i = 0; i < 3; i++)
             color[i] = color[i] * 2.0f - 1.0f;
         return {color[0], color[1], color[2]};
     }
 
     inline float Specular(Vec2f uv) const {
-        Vec4f color = m_specularmap->Sample2D(uv);
+        Vec4f color = m_specularbc ? m_specularbc->Sample2D(uv) : m_specularmap->Sample2D(uv);
         return color.b;
     }
 
 protected:
-    Bitmap* load_texture(std::string filename, const char* suffix) {
+    inline const MeshVertex& corner(int iface, int nthvert) const {
+        return m_mesh.GetVertices()[m_mesh.GetIndices()[iface * 3 + nthvert]];
+    }
+
+    static Bitmap* load_texture(std::string filename, const char* suffix) {
         std::string texfile(filename);
         size_t      dot = texfile.find_last_of(".");
         if (dot == std::string::npos) return NULL;
         texfile         = texfile.substr(0, dot) + std::string(suffix);
-        Bitmap* texture = Bitmap::LoadFile(texfile.c_str());
+        Bitmap* texture = Bitmap::LoadFile(texfile.c_str(), true);
         std::cout << "loading: " << texfile << ((texture) ? " OK" : " failed") << "\n";
-        texture->FlipVertical();
         return texture;
     }
 
 protected:
-    std::vector<Vec3f>              m_verts;
-    std::vector<std::vector<Vec3i>> m_faces;
-    std::vector<Vec3f>              m_norms;
-    std::vector<Vec2f>              m_uv;
-    Bitmap*                         m_diffusemap;
-    Bitmap*                         m_normalmap;
-    Bitmap*                         m_specularmap;
+    Mesh              m_mesh;
+    Bitmap*           m_diffusemap{nullptr};
+    Bitmap*           m_normalmap{nullptr};
+    Bitmap*           m_specularmap{nullptr};
+    CompressedBitmap* m_diffusebc{nullptr};
+    CompressedBitmap* m_normalbc{nullptr};
+    CompressedBitmap* m_specularbc{nullptr};
 };
+
+// 异步加载句柄，可以拷贝，所有拷贝共享同一个加载结果
+class ModelHandle {
+public:
+    ModelHandle() = default;
+
+    // 几何与纹理是否都已加载完成
+    [[nodiscard]] bool Ready() const {
+        if (!m_state) return false;
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (m_state->model) return true;
+        auto ready = [](auto& future) {
+            return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        };
+        return ready(m_state->geometry) && ready(m_state->diffuse) && ready(m_state->normal) &&
+               ready(m_state->specular);
+    }
+
+    // 阻塞直到加载完成，返回组装好的模型
+    std::shared_ptr<Model> Get() const {
+        if (!m_state) return nullptr;
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (!m_state->model) {
+            auto model = m_state->geometry.get();
+            auto diffuse  = m_state->diffuse.get();
+            auto normal   = m_state->normal.get();
+            auto specular = m_state->specular.get();
+            if (model)
+                model->attach_textures(std::move(diffuse), std::move(normal), std::move(specular));
+            m_state->model = model;
+        }
+        return m_state->model;
+    }
+
+private:
+    friend class Model;
+
+    struct State {
+        std::mutex                          mutex;
+        std::future<std::shared_ptr<Model>> geometry;
+        std::future<Model::TextureAsset>    diffuse;
+        std::future<Model::TextureAsset>    normal;
+        std::future<Model::TextureAsset>    specular;
+        std::shared_ptr<Model>              model;
+    };
+
+    std::shared_ptr<State> m_state;
+};
+
+inline ModelHandle Model::LoadAsync(const std::string& filename, bool compressTextures,
+                                    ThreadPool& pool) {
+    ModelHandle handle;
+    handle.m_state           = std::make_shared<ModelHandle::State>();
+    handle.m_state->geometry = pool.Submit([filename]() -> std::shared_ptr<Model> {
+        std::shared_ptr<Model> model(new Model());
+        if (!model->LoadGeometry(filename.c_str())) return nullptr;
+        return model;
+    });
+    handle.m_state->diffuse  = pool.Submit([filename, compressTextures] {
+        return load_texture_asset(filename, "_diffuse.bmp", compressTextures, DIFFUSE_FORMAT);
+    });
+    handle.m_state->normal   = pool.Submit([filename, compressTextures] {
+        return load_texture_asset(filename, "_nm.bmp", compressTextures, NORMAL_FORMAT);
+    });
+    handle.m_state->specular = pool.Submit([filename, compressTextures] {
+        return load_texture_asset(filename, "_spec.bmp", compressTextures, SPECULAR_FORMAT);
+    });
+    return handle;
+}
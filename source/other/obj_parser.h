@@ -0,0 +1,276 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <vector>
+
+#include "mapped_file.h"
+#include "math.h"
+#include "thread_pool.h"
+
+// OBJ 解析结果，面已经三角化（多边形按扇形拆分）
+struct ObjData {
+    std::vector<Vec3f> positions;
+    std::vector<Vec3f> normals;
+    std::vector<Vec2f> uvs;
+    std::vector<Vec3i> corners; // 每个三角形三个角：(v, vt, vn)，缺失的分量为 -1
+};
+
+// 高速 OBJ 解析器：文件映射进内存，先统计数量预分配，再用 from_chars 逐行解析
+// 大文件按行切分成多块，每块的输出位置由统计阶段的前缀和决定，因此可以并行解析
+class ObjParser {
+public:
+    // 超过这个大小的文件才会分块并行解析
+    static constexpr size_t PARALLEL_THRESHOLD = 1 << 20;
+
+    static bool Parse(const char* filename, ObjData& out, bool parallel = true,
+                      ThreadPool& pool = ThreadPool::Instance()) {
+        MappedFile file(filename);
+        if (!file.IsOpen()) return false;
+        const char* data = reinterpret_cast<const char*>(file.GetData());
+        Parse(data, data + file.GetSize(), out, parallel ? &pool : nullptr);
+        return true;
+    }
+
+    static void Parse(const char* begin, const char* end, ObjData& out, ThreadPool* pool) {
+        // 按行边界切块
+        size_t chunkCount = 1;
+        if (pool && (size_t)(end - begin) >= PARALLEL_THRESHOLD)
+            chunkCount = pool->GetThreadCount() * 4;
+        std::vector<Chunk> chunks(chunkCount);
+        const char*        cursor = begin;
+        for (size_t i = 0; i < chunkCount; i++) {
+            const char* split = begin + (end - begin) * (i + 1) / chunkCount;
+            if (split < cursor) split = cursor;
+            while (split < end && split[-1] != '\n')
+                split++;
+            chunks[i].begin = cursor;
+            chunks[i].end   = (i + 1 == chunkCount) ? end : split;
+            cursor          = chunks[i].end;
+        }
+
+        // 第一遍：统计每块的元素数量
+        auto forEachChunk = [&](auto&& fn) {
+            if (pool) {
+                pool->ParallelFor(chunkCount, [&](size_t i) { fn(chunks[i]); });
+            } else {
+                for (auto& chunk : chunks)
+                    fn(chunk);
+            }
+        };
+        forEachChunk([](Chunk& chunk) { CountChunk(chunk); });
+
+        // 前缀和得到每块的输出偏移
+        Counts total;
+        for (auto& chunk : chunks) {
+            chunk.base = total;
+            total.v += chunk.counts.v;
+            total.vt += chunk.counts.vt;
+            total.vn += chunk.counts.vn;
+            total.tris += chunk.counts.tris;
+        }
+        out.positions.resize(total.v);
+        out.uvs.resize(total.vt);
+        out.normals.resize(total.vn);
+        out.corners.resize(total.tris * 3);
+
+        // 第二遍：直接写入各自的区间
+        forEachChunk([&out](Chunk& chunk) { ParseChunk(chunk, out); });
+
+        // 去掉引用了不存在顶点的三角形，越界的纹理坐标/法线视为缺失
+        size_t count = 0;
+        for (size_t i = 0; i < out.corners.size(); i += 3) {
+            bool ok = true;
+            for (size_t j = 0; j < 3; j++) {
+                Vec3i& corner = out.corners[i + j];
+                ok &= corner[0] >= 0 && (size_t)corner[0] < total.v;
+                if ((size_t)corner[1] >= total.vt) corner[1] = -1;
+                if ((size_t)corner[2] >= total.vn) corner[2] = -1;
+            }
+            if (!ok) continue;
+            for (size_t j = 0; j < 3; j++)
+                out.corners[count++] = out.corners[i + j];
+        }
+        out.corners.resize(count);
+    }
+
+private:
+    struct Counts {
+        size_t v{0};
+        size_t vt{0};
+        size_t vn{0};
+        size_t tris{0};
+    };
+
+    struct Chunk {
+        const char* begin{nullptr};
+        const char* end{nullptr};
+        Counts      counts;
+        Counts      base;
+    };
+
+    enum class LineType { Other, Position, TexCoord, Normal, Face };
+
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static const char* SkipSpace(const char* p, const char* end) {
+        while (p < end && IsSpace(*p))
+            p++;
+        return p;
+    }
+
+    static const char* LineEnd(const char* p, const char* end) {
+        while (p < end && *p != '\n')
+            p++;
+        return p;
+    }
+
+    // 识别行类型，返回关键字之后的位置
+    static LineType Classify(const char*& p, const char* end) {
+        p = SkipSpace(p, end);
+        if (p >= end) return LineType::Other;
+        if (p[0] == 'f' && p + 1 < end && IsSpace(p[1])) {
+            p += 1;
+            return LineType::Face;
+        }
+        if (p[0] != 'v') return LineType::Other;
+        if (p + 1 < end && IsSpace(p[1])) {
+            p += 1;
+            return LineType::Position;
+        }
+        if (p + 2 < end && IsSpace(p[2])) {
+            char c = p[1];
+            p += 2;
+            if (c == 't') return LineType::TexCoord;
+            if (c == 'n') return LineType::Normal;
+        }
+        return LineType::Other;
+    }
+
+    static void CountChunk(Chunk& chunk) {
+        const char* end = chunk.end;
+        for (const char* p = chunk.begin; p < end;) {
+            const char* lineEnd = LineEnd(p, end);
+            switch (Classify(p, lineEnd)) {
+            case LineType::Position:
+                chunk.counts.v++;
+                break;
+            case LineType::TexCoord:
+                chunk.counts.vt++;
+                break;
+            case LineType::Normal:
+                chunk.counts.vn++;
+                break;
+            case LineType::Face: {
+                size_t tokens = CountTokens(p, lineEnd);
+                if (tokens >= 3) chunk.counts.tris += tokens - 2;
+                break;
+            }
+            default:
+                break;
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    static size_t CountTokens(const char* p, const char* end) {
+        size_t tokens = 0;
+        for (;;) {
+            p = SkipSpace(p, end);
+            if (p >= end || *p == '#') return tokens;
+            tokens++;
+            while (p < end && !IsSpace(*p))
+                p++;
+        }
+    }
+
+    static const char* ParseFloat(const char* p, const char* end, float& value) {
+        p = SkipSpace(p, end);
+        if (p < end && *p == '+') p++;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec != std::errc()) value = 0.0f;
+        return result.ptr;
+    }
+
+    // OBJ 索引从 1 开始，负数表示相对当前已定义数量的倒数
+    static int ResolveIndex(int index, size_t defined) {
+        if (index > 0) return index - 1;
+        if (index < 0 && (size_t)(-index) <= defined) return (int)defined + index;
+        return -1;
+    }
+
+    // 解析 v、v/vt、v//vn、v/vt/vn
+    static const char* ParseCorner(const char* p, const char* end, const Counts& defined,
+                                   Vec3i& corner) {
+        int index[3] = {0, 0, 0};
+        for (int k = 0; k < 3; k++) {
+            if (p < end && *p != '/' && !IsSpace(*p)) {
+                auto result = std::from_chars(p, end, index[k]);
+                p           = result.ptr;
+            }
+            if (k < 2) {
+                if (p >= end || *p != '/') break;
+                p++;
+            }
+        }
+        corner[0] = ResolveIndex(index[0], defined.v);
+        corner[1] = ResolveIndex(index[1], defined.vt);
+        corner[2] = ResolveIndex(index[2], defined.vn);
+        while (p < end && !IsSpace(*p))
+            p++;
+        return p;
+    }
+
+    static void ParseChunk(Chunk& chunk, ObjData& out) {
+        Counts      cursor = chunk.base;
+        const char* end    = chunk.end;
+        Vec3i*      tris   = out.corners.data() + cursor.tris * 3;
+        for (const char* p = chunk.begin; p < end;) {
+            const char* lineEnd = LineEnd(p, end);
+            switch (Classify(p, lineEnd)) {
+            case LineType::Position: {
+                Vec3f& v = out.positions[cursor.v++];
+                for (int i = 0; i < 3; i++)
+                    p = ParseFloat(p, lineEnd, v[i]);
+                break;
+            }
+            case LineType::TexCoord: {
+                Vec2f& uv = out.uvs[cursor.vt++];
+                for (int i = 0; i < 2; i++)
+                    p = ParseFloat(p, lineEnd, uv[i]);
+                break;
+            }
+            case LineType::Normal: {
+                Vec3f& n = out.normals[cursor.vn++];
+                for (int i = 0; i < 3; i++)
+                    p = ParseFloat(p, lineEnd, n[i]);
+                break;
+            }
+            case LineType::Face: {
+                // 扇形三角化：(c0, c1, c2), (c0, c2, c3) ...
+                Vec3i  first, prev, corner;
+                size_t count = 0;
+                for (;;) {
+                    p = SkipSpace(p, lineEnd);
+                    if (p >= lineEnd || *p == '#') break;
+                    p = ParseCorner(p, lineEnd, cursor, corner);
+                    if (count == 0) {
+                        first = corner;
+                    } else if (count >= 2) {
+                        *tris++ = first;
+                        *tris++ = prev;
+                        *tris++ = corner;
+                    }
+                    prev = corner;
+                    count++;
+                }
+                if (count >= 3) cursor.tris += count - 2;
+                break;
+            }
+            default:
+                break;
+            }
+            p = lineEnd + 1;
+        }
+    }
+};
@@ -1,21 +1,91 @@
 #pragma once
 
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "camera.h"
 #include "light.h"
 #include "model.h"
+#include "scene_node.h"
 
 class Scene {
 public:
-    void AddModel(const std::shared_ptr<Model>& model) { m_models.emplace_back(model); };
+    Scene()                        = default;
+    Scene(const Scene&)            = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    // 不带模型的节点，用来组织层级
+    SceneNode* CreateNode(SceneNode* parent = nullptr) {
+        m_nodes.emplace_back(new SceneNode(parent, &m_dirtyNodes));
+        return m_nodes.back().get();
+    }
+    SceneNode* AddModel(const std::shared_ptr<Model>& model, SceneNode* parent = nullptr) {
+        SceneNode* node = CreateNode(parent);
+        AttachModel(node, model);
+        return node;
+    }
+    // 仍在加载中的模型，节点立即创建，加载完成后的第一次 Update 把模型挂到节点上
+    SceneNode* AddModel(const ModelHandle& handle, SceneNode* parent = nullptr) {
+        SceneNode* node = CreateNode(parent);
+        m_pendingModels.emplace_back(handle, node);
+        return node;
+    }
     void AddLight(const std::shared_ptr<BasicLight>& basicLight) {
         m_lights.emplace_back(basicLight);
     };
-    [[nodiscard]] auto GetModels() { return m_models; }
+
+    // 每帧绘制前调用：挂上加载完成的模型，重算变化过的节点
+    // 开销只和变化的节点（及其子树）数量有关，不遍历整个场景
+    void Update() {
+        PollPendingModels();
+        for (SceneNode* node : m_dirtyNodes) {
+            // 已经随脏的祖先一起更新过
+            if (!node->IsDirty()) continue;
+            // 从最上层的脏祖先开始更新，整棵子树只算一次
+            SceneNode* top = node;
+            for (SceneNode* parent = node->Parent(); parent; parent = parent->Parent()) {
+                if (parent->IsDirty()) top = parent;
+            }
+            top->UpdateSubtree();
+        }
+        m_dirtyNodes.clear();
+    }
+
+    // 已经有模型的节点，世界矩阵在最近一次 Update 之后有效
+    [[nodiscard]] const std::vector<SceneNode*>& GetRenderables() const { return m_renderables; }
     [[nodiscard]] auto GetLights() const { return m_lights; }
+    [[nodiscard]] bool HasPendingModels() const { return !m_pendingModels.empty(); }
+    [[nodiscard]] Camera&       GetCamera() { return m_camera; }
+    [[nodiscard]] const Camera& GetCamera() const { return m_camera; }
+
+    // 阻塞直到所有模型加载完成
+    void WaitForModels() {
+        for (auto& [handle, node] : m_pendingModels) {
+            if (auto model = handle.Get()) AttachModel(node, model);
+        }
+        m_pendingModels.clear();
+    }
+
+private:
+    void AttachModel(SceneNode* node, const std::shared_ptr<Model>& model) {
+        node->SetModel(model);
+        m_renderables.push_back(node);
+    }
+
+    void PollPendingModels() {
+        std::erase_if(m_pendingModels, [this](const std::pair<ModelHandle, SceneNode*>& pending) {
+            if (!pending.first.Ready()) return false;
+            if (auto model = pending.first.Get()) AttachModel(pending.second, model);
+            return true;
+        });
+    }
 
 private:
-    std::vector<std::shared_ptr<Model>>      m_models;
-    std::vector<std::shared_ptr<BasicLight>> m_lights;
-};
\ No newline at end of file
+    std::vector<std::unique_ptr<SceneNode>>         m_nodes;
+    std::vector<SceneNode*>                         m_dirtyNodes;
+    std::vector<SceneNode*>                         m_renderables;
+    std::vector<std::pair<ModelHandle, SceneNode*>> m_pendingModels;
+    std::vector<std::shared_ptr<BasicLight>>        m_lights;
+    Camera                                          m_camera;
+};
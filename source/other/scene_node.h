@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "math.h"
+#include "model.h"
+
+// 场景节点：局部变换 + 父节点，世界矩阵和由它派生的法线矩阵、世界包围球缓存在节点里
+// 修改局部变换只把节点放进所属 Scene 的脏列表，Scene::Update 时只重算脏节点和它们的子树
+class SceneNode {
+public:
+    SceneNode(const SceneNode&)            = delete;
+    SceneNode& operator=(const SceneNode&) = delete;
+
+    void SetLocalTransform(const Mat4x4f& local) {
+        m_local = local;
+        MarkDirty();
+    }
+
+    // 逐实例参数：乘到模型的漫反射颜色上，不影响世界矩阵
+    void SetInstanceColor(const Vec4f& color) {
+        m_instanceColor = color;
+        m_version++;
+    }
+
+    // 模型可以在节点创建之后才加载完成
+    void SetModel(const std::shared_ptr<Model>& model) {
+        m_model = model;
+        MarkDirty();
+    }
+
+    [[nodiscard]] const Mat4x4f&                LocalTransform() const { return m_local; }
+    [[nodiscard]] const Mat4x4f&                WorldTransform() const { return m_world; }
+    [[nodiscard]] const Mat3x3f&                NormalMatrix() const { return m_normal; }
+    [[nodiscard]] const Vec3f&                  WorldCenter() const { return m_worldCenter; }
+    [[nodiscard]] float                         WorldRadius() const { return m_worldRadius; }
+    [[nodiscard]] const Vec4f&                  InstanceColor() const { return m_instanceColor; }
+    [[nodiscard]] const std::shared_ptr<Model>& GetModel() const { return m_model; }
+    [[nodiscard]] SceneNode*                    Parent() const { return m_parent; }
+    [[nodiscard]] const std::vector<SceneNode*>& Children() const { return m_children; }
+    [[nodiscard]] bool                          IsDirty() const { return m_dirty; }
+    // 世界矩阵、模型或实例参数每变化一次加一，用来判断两帧之间节点是否变化
+    [[nodiscard]] uint32_t Version() const { return m_version; }
+
+private:
+    friend class Scene;
+
+    SceneNode(SceneNode* parent, std::vector<SceneNode*>* dirtyList)
+        : m_parent(parent), m_dirtyList(dirtyList) {
+        if (parent) parent->m_children.push_back(this);
+        MarkDirty();
+    }
+
+    void MarkDirty() {
+        if (m_dirty) return;
+        m_dirty = true;
+        m_dirtyList->push_back(this);
+    }
+
+    // 重算自己和整棵子树：子节点的世界矩阵依赖这里的结果
+    void UpdateSubtree() {
+        m_world  = m_parent ? m_local * m_parent->m_world : m_local;
+        // 逆转置会把均匀缩放 s 变成 1/s，乘回 det 的立方根，着色器里的法线保持原来的长度
+        Vec3f r0 = Vec3f(m_world.m[0]), r1 = Vec3f(m_world.m[1]), r2 = Vec3f(m_world.m[2]);
+        float det = vector_dot(r0, vector_cross(r1, r2));
+        m_normal  = matrix_normal(m_world) * cbrtf(Abs(det));
+        if (m_model) {
+            const MeshBounds& bounds = m_model->bounds();
+            float             scale  = 0.0f;
+            for (size_t i = 0; i < 3; i++)
+                scale = Max(scale, vector_length(m_world.Row(i).xyz()));
+            m_worldCenter = (((bounds.min + bounds.max) * 0.5f).xyz1() * m_world).xyz();
+            m_worldRadius = vector_length(bounds.max - bounds.min) * 0.5f * scale;
+        }
+        m_dirty = false;
+        m_version++;
+        for (SceneNode* child : m_children)
+            child->UpdateSubtree();
+    }
+
+private:
+    Mat4x4f                  m_local{matrix_set_identity()};
+    Mat4x4f                  m_world{matrix_set_identity()};
+    Mat3x3f                  m_normal{matrix_normal(matrix_set_identity())};
+    Vec3f                    m_worldCenter{0.0f, 0.0f, 0.0f};
+    float                    m_worldRadius{0.0f};
+    Vec4f                    m_instanceColor{1.0f, 1.0f, 1.0f, 1.0f};
+    std::shared_ptr<Model>   m_model;
+    SceneNode*               m_parent{nullptr};
+    std::vector<SceneNode*>  m_children;
+    std::vector<SceneNode*>* m_dirtyList{nullptr}; // 所属 Scene 的脏列表
+    bool                     m_dirty{false};
+    uint32_t                 m_version{0};
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "math.h"
+#include "tiled_buffer.h"
+
+// 方向光的阴影贴图：光源空间的正交投影深度（z，越小越近），由 Renderer::RenderShadowMap 生成
+// 光源和投射阴影的物体都不变时签名相同，直接复用上一次的结果
+class ShadowMap {
+public:
+    static constexpr float DEPTH_BIAS = 0.002f; // 单位是正交投影的深度范围
+
+    void Resize(int size) {
+        if (size == m_size) return;
+        m_size = size;
+        m_depth.Resize(size, size);
+        m_signature = 0;
+    }
+
+    // 3x3 PCF：返回 posWorld 被照亮的比例，阴影贴图范围以外视为照亮
+    [[nodiscard]] float Lit(const Vec3f& posWorld) const {
+        Vec4f p = posWorld.xyz1() * m_viewProj;
+        if (p.z > 1.0f) return 1.0f;
+        float u     = (p.x + 1.0f) * 0.5f * m_size;
+        float v     = (1.0f - p.y) * 0.5f * m_size;
+        int   cx    = (int)floorf(u);
+        int   cy    = (int)floorf(v);
+        float depth = p.z - DEPTH_BIAS;
+        int   lit   = 0;
+        for (int y = cy - 1; y <= cy + 1; y++) {
+            for (int x = cx - 1; x <= cx + 1; x++) {
+                if (x < 0 || y < 0 || x >= m_size || y >= m_size || depth <= Depth(x, y)) lit++;
+            }
+        }
+        return lit * (1.0f / 9.0f);
+    }
+
+    [[nodiscard]] const Mat4x4f& ViewProj() const { return m_viewProj; }
+    [[nodiscard]] int            Size() const { return m_size; }
+
+private:
+    friend class Renderer;
+
+    // 没有被写过的块保持清除值 1，不需要先填充
+    [[nodiscard]] float Depth(int x, int y) const {
+        if (m_depth.IsTileCleared(x / DepthTiles::TILE_SIZE, y / DepthTiles::TILE_SIZE))
+            return m_depth.ClearValue();
+        return m_depth.At(x, y);
+    }
+
+private:
+    using DepthTiles = TiledBuffer<float>;
+    DepthTiles m_depth;
+    Mat4x4f    m_viewProj{matrix_set_identity()};
+    uint64_t   m_signature{0}; // 生成这张贴图时的光源和物体签名，0 表示无效
+    int        m_size{0};
+};
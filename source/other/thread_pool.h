@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 固定线程数的任务队列，Submit 返回 future
+// 任务之间不应互相等待，否则线程数不足时会死锁
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount) {
+        if (threadCount == 0) threadCount = 1;
+        for (size_t i = 0; i < threadCount; i++)
+            m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool& other)            = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    // 全局线程池，线程数与硬件线程数相同
+    static ThreadPool& Instance() {
+        static ThreadPool pool(std::thread::hardware_concurrency());
+        return pool;
+    }
+
+    template <typename F> auto Submit(F&& task) -> std::future<std::invoke_result_t<F>> {
+        using R      = std::invoke_result_t<F>;
+        auto package = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+        std::future<R> result = package->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.emplace([package] { (*package)(); });
+        }
+        m_condition.notify_one();
+        return result;
+    }
+
+    // 并行执行 fn(0) ... fn(count - 1)
+    // 调用线程也参与执行，等待的是任务计数而不是 future，因此可以在线程池任务内部调用
+    template <typename F> void ParallelFor(size_t count, F&& fn) {
+        if (count == 0) return;
+        if (count == 1 || m_workers.size() <= 1) {
+            for (size_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+        struct Job {
+            std::function<void(size_t)> fn;
+            size_t                      count{0};
+            std::atomic<size_t>         next{0};
+            std::atomic<size_t>         done{0};
+            std::mutex                  mutex;
+            std::condition_variable     finished;
+        };
+        auto job   = std::make_shared<Job>();
+        job->fn    = std::ref(fn);
+        job->count = count;
+        // 迟到的工作线程拿不到新的下标，不会再访问 fn
+        auto run = [job] {
+            for (size_t i = job->next++; i < job->count; i = job->next++) {
+                job->fn(i);
+                if (++job->done == job->count) {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    job->finished.notify_all();
+                }
+            }
+        };
+        size_t helpers = std::min(count, m_workers.size()) - 1;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < helpers; i++)
+                m_tasks.emplace(run);
+        }
+        m_condition.notify_all();
+        run();
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&job] { return job->done == job->count; });
+    }
+
+    [[nodiscard]] size_t GetThreadCount() const { return m_workers.size(); }
+
+private:
+    void WorkerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_stopping && m_tasks.empty()) return;
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+
+private:
+    std::vector<std::thread>          m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_condition;
+    bool                              m_stopping{false};
+};
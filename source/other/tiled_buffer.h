@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 按块存储的二维缓冲：块内行优先，块之间也按行优先排列
+// 8x8 的块中 float 深度正好占 4 条缓存行，一个三角形覆盖的小区域只会碰到少数几条缓存行
+// 宽高向上对齐到块大小，多出来的部分不会被显示
+// 支持快速清除：每个块有一个"已清除"标记，清除只需 O(块数)，块第一次被访问前才真正填充
+template <typename T, int TILE_SHIFT = 3> class TiledBuffer {
+public:
+    static constexpr int TILE_SIZE   = 1 << TILE_SHIFT;
+    static constexpr int TILE_MASK   = TILE_SIZE - 1;
+    static constexpr int TILE_PIXELS = TILE_SIZE * TILE_SIZE;
+
+    void Resize(int width, int height) {
+        m_width  = width;
+        m_height = height;
+        m_tilesX = (width + TILE_MASK) >> TILE_SHIFT;
+        m_tilesY = (height + TILE_MASK) >> TILE_SHIFT;
+        m_data.resize((size_t)m_tilesX * m_tilesY * TILE_PIXELS);
+        m_cleared.assign((size_t)m_tilesX * m_tilesY, 1);
+    }
+
+    // 立即写满整个缓冲
+    void Fill(const T& value) {
+        std::fill(m_data.begin(), m_data.end(), value);
+        std::fill(m_cleared.begin(), m_cleared.end(), 0);
+    }
+
+    // 快速清除：只记录清除值并标记所有块
+    void Clear(const T& value) {
+        m_clearValue = value;
+        std::fill(m_cleared.begin(), m_cleared.end(), 1);
+    }
+
+    // 读写第 y 行 [x0, x1] 之前调用：经过的块如果还处于清除状态，先填充清除值
+    void Touch(int x0, int x1, int y) {
+        size_t tileRow = (size_t)(y >> TILE_SHIFT) * m_tilesX;
+        for (int tx = x0 >> TILE_SHIFT; tx <= (x1 >> TILE_SHIFT); tx++) {
+            size_t tile = tileRow + tx;
+            if (!m_cleared[tile]) continue;
+            std::fill_n(m_data.data() + tile * TILE_PIXELS, TILE_PIXELS, m_clearValue);
+            m_cleared[tile] = 0;
+        }
+    }
+
+    bool     IsTileCleared(int tx, int ty) const { return m_cleared[(size_t)ty * m_tilesX + tx]; }
+    const T& ClearValue() const { return m_clearValue; }
+
+    // Index(x, y) = RowOffset(y) + ColumnOffset(x)，扫描一行时 RowOffset 只算一次
+    size_t RowOffset(int y) const {
+        return ((size_t)(y >> TILE_SHIFT) * m_tilesX << (2 * TILE_SHIFT)) +
+               ((size_t)(y & TILE_MASK) << TILE_SHIFT);
+    }
+    static size_t ColumnOffset(int x) {
+        return ((size_t)(x >> TILE_SHIFT) << (2 * TILE_SHIFT)) + (x & TILE_MASK);
+    }
+    size_t Index(int x, int y) const { return RowOffset(y) + ColumnOffset(x); }
+
+    T&       At(int x, int y) { return m_data[Index(x, y)]; }
+    const T& At(int x, int y) const { return m_data[Index(x, y)]; }
+    T*       Data() { return m_data.data(); }
+    const T* Data() const { return m_data.data(); }
+
+    // 块 (tx, ty) 的起始地址，块内 TILE_PIXELS 个元素连续
+    T* TileData(int tx, int ty) {
+        return m_data.data() + Index(tx << TILE_SHIFT, ty << TILE_SHIFT);
+    }
+
+    // 把第 y 行的前 width 个元素（默认整行）还原成线性排列
+    // 处于清除状态的块直接输出清除值，不读取块的内存
+    void ReadRow(int y, T* out, int width = -1) const {
+        if (width < 0) width = m_width;
+        const T*       row     = m_data.data() + RowOffset(y);
+        const uint8_t* cleared = m_cleared.data() + (size_t)(y >> TILE_SHIFT) * m_tilesX;
+        for (int x = 0; x < width; x += TILE_SIZE) {
+            int count = std::min(TILE_SIZE, width - x);
+            if (cleared[x >> TILE_SHIFT])
+                std::fill_n(out + x, count, m_clearValue);
+            else
+                std::copy_n(row + ((size_t)(x >> TILE_SHIFT) << (2 * TILE_SHIFT)), count, out + x);
+        }
+    }
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    int TilesX() const { return m_tilesX; }
+    int TilesY() const { return m_tilesY; }
+
+private:
+    std::vector<T>       m_data;
+    std::vector<uint8_t> m_cleared; // 每个块一个标记，1 表示内容等于 m_clearValue
+    T                    m_clearValue{};
+    int                  m_width{0};
+    int                  m_height{0};
+    int                  m_tilesX{0};
+    int                  m_tilesY{0};
+};
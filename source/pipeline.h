@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+enum class CullMode : uint8_t {
+    None,  // 正反面都绘制
+    Back,  // 剔除背面
+    Front, // 剔除正面
+};
+
+enum class BlendMode : uint8_t {
+    Opaque,   // 直接覆盖
+    Additive, // dst + src
+    Alpha,    // src * src.a + dst * (1 - src.a)
+};
+
+// 着色率：每 2^n x 2^n 个像素只执行一次像素着色器，覆盖和深度仍然逐像素计算
+enum class ShadingRate : uint8_t {
+    Rate1x1,
+    Rate2x2,
+    Rate4x4,
+};
+
+// 光栅化循环的开关位，和混合模式一起组成模板参数
+constexpr uint32_t PIPELINE_DEPTH_TEST  = 1 << 0;
+constexpr uint32_t PIPELINE_DEPTH_WRITE = 1 << 1;
+constexpr uint32_t PIPELINE_COLOR_WRITE = 1 << 2;
+constexpr uint32_t PIPELINE_PERSPECTIVE = 1 << 3;
+constexpr uint32_t PIPELINE_BLEND_SHIFT = 4;
+constexpr uint32_t PIPELINE_VARIANTS    = 3 << PIPELINE_BLEND_SHIFT;
+
+// 管线状态：Renderer 按它选择一个模板实例化的光栅化循环，关掉的功能在循环里没有任何开销
+struct PipelineState {
+    bool        depthTest{true};
+    bool        depthWrite{true};
+    bool        colorWrite{true};
+    bool        perspectiveCorrect{true};
+    CullMode    cullMode{CullMode::None};
+    BlendMode   blendMode{BlendMode::Opaque};
+    ShadingRate shadingRate{ShadingRate::Rate1x1}; // 和屏幕块的着色率取较粗的一个
+
+    constexpr uint32_t RasterKey() const {
+        return (depthTest ? PIPELINE_DEPTH_TEST : 0) | (depthWrite ? PIPELINE_DEPTH_WRITE : 0) |
+               (colorWrite ? PIPELINE_COLOR_WRITE : 0) |
+               (perspectiveCorrect ? PIPELINE_PERSPECTIVE : 0) |
+               ((uint32_t)blendMode << PIPELINE_BLEND_SHIFT);
+    }
+
+    // 只写深度，不执行像素着色器（阴影、pre-z）
+    static constexpr PipelineState DepthOnly() {
+        PipelineState state;
+        state.colorWrite         = false;
+        state.perspectiveCorrect = false;
+        state.cullMode           = CullMode::Back;
+        return state;
+    }
+
+    // 不受深度影响的半透明叠加层
+    static constexpr PipelineState Overlay() {
+        PipelineState state;
+        state.depthTest          = false;
+        state.depthWrite         = false;
+        state.perspectiveCorrect = false;
+        state.blendMode          = BlendMode::Alpha;
+        return state;
+    }
+};
@@ -3,139 +3,371 @@
 #include <SDL2/SDL.h>
 
 #include <algorithm>
-#include <execution>
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <iostream>
 #include <ranges>
 #include <utility>
 
+#include "other/frame_signature.h"
+
 constexpr int VARYING_UV    = 0;
 constexpr int VARYING_EYE   = 1;
 
+// 模型包围球投影到屏幕上的每个像素最多分到多少个三角形
+constexpr float LOD_TRIANGLES_PER_PIXEL = 0.5f;
+
+// 同一个模型的实例每次批量变换多少个，裁剪坐标缓冲的大小是它乘以顶点数
+constexpr int INSTANCE_GROUP = 16;
+
+// 重投影：上一帧对应位置的 1/w 相对误差超过它就认为是另一个表面
+constexpr float    REPROJECTION_DEPTH_TOLERANCE = 0.01f;
+// 每帧轮流重新着色 1/N 的 8x8 块，限制多次重投影累积的误差
+constexpr uint32_t REPROJECTION_REFRESH_PERIOD  = 16;
+// 上次重投影复用的像素少于这个比例时，相机动得太快，下一帧直接完整绘制
+constexpr float    REPROJECTION_MIN_REUSE       = 0.25f;
+
 static bool IsTopLeft(const Vec2i& a, const Vec2i& b) {
     return ((a.y == b.y) && (a.x < b.x)) || (a.y > b.y);
 }
 
 void Renderer::RenderScene(Scene& scene) {
-    Vec3f eyePos      = {0, 0, 2};
-    Vec3f eyeAt       = {0, 0, 0};
-    Vec3f eyeUp       = {0, 1, 0};
-    Vec3f lightDir    = {1, 1, 0.85};
-    float perspective = 3.1415926f * 0.5f;
-
-    // 变换矩阵
-    Mat4x4f matModel   = matrix_set_rotate(0, 1, 0, 0);
-    Mat4x4f matView    = matrix_set_lookat(eyePos, eyeAt, eyeUp);
-    Mat4x4f matProj    = matrix_set_perspective(perspective, 9.0 / 6.0, 1.0, 500.0f);
-    Mat4x4f mvp        = matModel * matView * matProj;
-    Mat4x4f matModelIt = matrix_invert(matModel).Transpose();
+    Camera& camera = scene.GetCamera();
+    // 着色器读取的参数块：相机和光照每帧（每个 pass）写一次，实例参数每次绘制写一次
+    FrameUniforms  frame;
+    ObjectUniforms object;
+    SetUniforms(&frame, &object);
 
     std::array<VertexAttrib, 3> vsInputs;
 
-    for (const auto& model : scene.GetModels()) {
-        for (const auto& light : scene.GetLights()) {
-            for (bool running = true; running;) {
-                SDL_Event event;
-                while (SDL_PollEvent(&event)) {
-                    switch (event.type) {
-                    case SDL_QUIT:
-                        running = false;
-                        break;
-                    }
-                }
-                RenderClear();
-
-                SetVertexShader([&](VertexAttrib& vsInput, ShaderContext& output) -> Vec4f {
-                    Vec4f pos                        = vsInput.pos.xyz1() * mvp;
-                    Vec3f posWorld                   = (vsInput.pos.xyz1() * matModel).xyz();
-                    Vec3f eyeDir                     = eyePos - posWorld;
-                    output.varyingVec2f[VARYING_UV]  = vsInput.uv;
-                    output.varyingVec3f[VARYING_EYE] = eyeDir;
-                    return pos;
-                });
+    // 模型是封闭网格，背面一定被正面挡住
+    PipelineState opaqueState;
+    opaqueState.cullMode = CullMode::Back;
+    // 之后的光源只在已写入的深度上把光照叠加到 HDR 颜色缓冲
+    PipelineState additiveState = opaqueState;
+    additiveState.depthWrite    = false;
+    additiveState.blendMode     = BlendMode::Additive;
 
-                SetPixelShader([&](ShaderContext& input) {
-                    Vec2f uv         = input.varyingVec2f[VARYING_UV];
-                    Vec3f eyeDir     = input.varyingVec3f[VARYING_EYE];
-                    Vec3f normal     = (model->normal(uv).xyz1() * matModelIt).xyz();
-                 
-                    if (vector_dot(normal, eyeDir) < 0) return Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
-                    Vec4f baseColor  = model->diffuse(uv);
-                    Vec3f lightColor = light->GetLightColor();
-                    Vec3f lightDir   = vector_normalize(light->GetLightDir());
-                    Vec3f reflectionDir =
-                        vector_normalize(normal * vector_dot(normal, lightDir) * 2.0f - lightDir);
-
-                    float specBaseFactor = Saturate(vector_dot(reflectionDir, eyeDir));
-                    float specIntensity =
-                        0.05 * Saturate(pow(specBaseFactor, model->Specular(uv) * 10));
-
-                    float diffuseIntensity = vector_dot(lightDir, normal);
-
-                    Vec4f outputColor =
-                        (diffuseIntensity + 0.1f + specIntensity) * baseColor * lightColor.xyz1();
-                    return vector_clamp(outputColor, 0.0f, 1.0f);
-                });
+    // 时间复用时的深度预绘制，和 opaqueState 产生完全相同的深度
+    PipelineState depthState = PipelineState::DepthOnly();
+
+    // 着色器只创建一次，需要的参数都从 ShaderContext 的参数块读取
+    // 顶点着色器直接取批量变换的结果，和 pos * mvp 逐位相同
+    VertexShader depthVertexShader = [this](VertexAttrib& vsInput, ShaderContext& output) {
+        return ClipPosition(output.object->clipOffset + vsInput.index);
+    };
+    VertexShader litVertexShader = [this](VertexAttrib& vsInput, ShaderContext& output) {
+        Vec3f posWorld = (vsInput.pos.xyz1() * output.object->world).xyz();
+        Vec3f eyeDir   = output.frame->eyePos - posWorld;
+        output.varyingVec2f[VARYING_UV]  = vsInput.uv;
+        output.varyingVec3f[VARYING_EYE] = eyeDir;
+        return ClipPosition(output.object->clipOffset + vsInput.index);
+    };
+    PixelShader litPixelShader = [this](ShaderContext& input) {
+        const FrameUniforms&  frame  = *input.frame;
+        const ObjectUniforms& object = *input.object;
+        const Model&          model  = *object.model;
+
+        Vec2f uv     = input.varyingVec2f[VARYING_UV];
+        Vec3f eyeDir = input.varyingVec3f[VARYING_EYE];
+        Vec3f normal = model.normal(uv) * object.normal;
+
+        if (vector_dot(normal, eyeDir) < 0) return Vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+        Vec4f baseColor   = model.diffuse(uv) * object.color;
+        Vec4f outputColor = frame.ambient * baseColor;
+        if (frame.hasLight) {
+            Vec3f lightDir      = frame.lightDir;
+            Vec3f reflectionDir = vector_normalize(
+                normal * vector_dot(normal, lightDir) * 2.0f - lightDir);
+
+            float specBaseFactor = Saturate(vector_dot(reflectionDir, eyeDir));
+            float specIntensity  = 0.05 * Saturate(pow(specBaseFactor, model.Specular(uv) * 10));
+
+            float diffuseIntensity = vector_dot(lightDir, normal);
+            // 阴影只减弱直接光照；背光面本来就是负值，不受影响
+            if (frame.shadowMap) {
+                float lit = frame.shadowMap->Lit(frame.eyePos - eyeDir);
+                if (diffuseIntensity > 0.0f) diffuseIntensity *= lit;
+                specIntensity *= lit;
+            }
 
-                for (int i = 0; i < model->nfaces(); ++i) {
+            outputColor = (diffuseIntensity + frame.ambient + specIntensity) * baseColor *
+                          frame.lightColor.xyz1();
+        }
+        // 局部光源只在第一遍累加，每个像素只遍历所在屏幕块的光源列表
+        auto tileLights =
+            frame.localLights ? TileLights(input.fragCoord) : std::span<const uint32_t>();
+        if (!tileLights.empty()) {
+            Vec3f posWorld   = frame.eyePos - eyeDir;
+            Vec3f viewDir    = vector_normalize(eyeDir);
+            Vec3f unitNormal = vector_normalize(normal);
+            float specPower  = model.Specular(uv) * 10;
+            Vec3f radiance(0.0f, 0.0f, 0.0f);
+            for (uint32_t index : tileLights) {
+                const LocalLight& local   = m_localLights[index];
+                Vec3f             toLight = local.position - posWorld;
+                float             distSq  = vector_dot(toLight, toLight);
+                float             rangeSq = local.range * local.range;
+                if (distSq >= rangeSq) continue;
+                Vec3f lightDir = toLight / sqrtf(distSq);
+                float diffuse  = vector_dot(lightDir, unitNormal);
+                if (diffuse <= 0.0f) continue;
+                // 到 range 处平滑降为 0 的平方反比衰减
+                float ratio   = distSq / rangeSq;
+                float window  = Saturate(1.0f - ratio * ratio);
+                float falloff = window * window / (distSq + 1.0f);
+                float cone    = Saturate(
+                    (vector_dot(-lightDir, local.direction) - local.cosOuter) /
+                    (local.cosInner - local.cosOuter));
+                Vec3f reflectionDir = unitNormal * (diffuse * 2.0f) - lightDir;
+                float spec          = 0.05f * Saturate(powf(
+                    Saturate(vector_dot(reflectionDir, viewDir)), specPower));
+                radiance = radiance + local.color * ((diffuse + spec) * falloff * cone);
+            }
+            outputColor =
+                outputColor + baseColor * Vec4f(radiance.x, radiance.y, radiance.z, 0);
+        }
+        // 不截断高光，只去掉负的光照，避免叠加时抵消其他光源
+        return vector_max(outputColor, Vec4f(0.0f, 0.0f, 0.0f, 0.0f));
+    };
+
+    std::vector<const SceneNode*>            casters;
+    std::vector<const SceneNode*>            instances;
+    std::vector<uint32_t>                    lods;
+    std::vector<std::shared_ptr<BasicLight>> directionalLights;
+    std::vector<LocalLight>                  localLights;
+    float                                    instanceMatrices[INSTANCE_GROUP][4][4];
+    for (bool running = true; running;) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            switch (event.type) {
+            case SDL_QUIT:
+                running = false;
+                break;
+            }
+        }
+        auto frameStart = std::chrono::steady_clock::now();
+
+        // 投影的宽高比跟随窗口；矩阵和视锥平面只在相机参数变化时重算
+        camera.SetAspect((float)m_windowWidth / (float)m_windowHeight);
+        camera.Update();
+        const Mat4x4f& matView  = camera.View();
+        const Mat4x4f& matProj  = camera.Proj();
+        const Mat4x4f& viewProj = camera.ViewProj();
+        frame.view              = matView;
+        frame.proj              = matProj;
+        frame.viewProj          = viewProj;
+        frame.eyePos            = camera.Eye();
+
+        // 只重算变化过的节点；还在加载的模型不会出现在这里，加载完成后的下一帧开始绘制
+        scene.Update();
+        auto lights = scene.GetLights();
+        // 同一个模型的实例排在一起，成批绘制；视锥外的实例仍然投射阴影
+        const auto& renderables = scene.GetRenderables();
+        casters.assign(renderables.begin(), renderables.end());
+        std::stable_sort(casters.begin(), casters.end(), [](const SceneNode* a, const SceneNode* b) {
+            return a->GetModel().get() < b->GetModel().get();
+        });
+
+        // 相机以外的场景状态：节点、LOD、光源，任何一项变化都要完整重绘
+        // 可见性随相机变化，所以签名包含所有节点，而不只是视锥内的
+        FrameSignature signature;
+        instances.clear();
+        lods.clear();
+        for (const SceneNode* renderable : casters) {
+            signature.Add(renderable).Add(renderable->Version());
+            if (!camera.SphereVisible(renderable->WorldCenter(), renderable->WorldRadius()))
+                continue;
+            instances.push_back(renderable);
+            lods.push_back(SelectLod(*renderable, camera));
+            signature.Add(lods.back());
+        }
+        // 方向光每个绘制一遍；点光源和聚光灯按屏幕块剔除，在第一遍里一起累加
+        directionalLights.clear();
+        localLights.clear();
+        for (const auto& light : lights) {
+            signature.Add(light.get()).Add(light->GetLightColor()).Add(light->GetLightDir());
+            signature.Add(light->CastShadow());
+            if (light->GetType() == LightType::Directional) {
+                directionalLights.push_back(light);
+            } else {
+                localLights.push_back(static_cast<const PointLight&>(*light).GetLocalLight());
+                signature.Add(localLights.back());
+            }
+        }
+
+        FrameReuse reuse = BeginFrame(signature.Value(), matView, matProj);
+        if (reuse == FrameReuse::Present) {
+            PresentPrevious();
+        } else {
+            RenderClear();
+            CullLights(localLights, matView, matProj);
+            // 阴影贴图只在光源方向或某个物体变化时重新生成
+            for (const auto& light : directionalLights) {
+                if (!light->CastShadow()) continue;
+                FrameSignature shadowSignature;
+                shadowSignature.Add(light->GetLightDir());
+                for (const SceneNode* caster : casters)
+                    shadowSignature.Add(caster).Add(caster->Version());
+                RenderShadowMap(m_shadowMaps[light.get()], light->GetLightDir(), casters,
+                                shadowSignature.Value());
+            }
+
+            // 同一个模型的实例每 INSTANCE_GROUP 个一组：顶点位置只读取一次，批量变换到每个实例的裁剪空间
+            // 有顶点在视锥外的三角形不进入顶点着色
+            auto drawGroups = [&](auto&& drawGroup) {
+                for (size_t begin = 0, end; begin < instances.size(); begin = end) {
+                    const Model& model = *instances[begin]->GetModel();
+                    for (end = begin + 1;
+                         end < instances.size() && instances[end]->GetModel().get() == &model; end++)
+                        ;
+                    const Vec3fSoA& positions = model.positionStream();
+                    size_t          count     = positions.size();
+                    for (size_t first = begin; first < end; first += INSTANCE_GROUP) {
+                        int groupSize = (int)Min(end - first, (size_t)INSTANCE_GROUP);
+                        for (int k = 0; k < groupSize; k++) {
+                            Mat4x4f instanceMvp = instances[first + k]->WorldTransform() * viewProj;
+                            std::copy_n(&instanceMvp.m[0][0], 16, &instanceMatrices[k][0][0]);
+                        }
+                        m_clipVertices.resize(count * groupSize);
+                        m_kernels.transformInstances(
+                            positions.x.data(), positions.y.data(), positions.z.data(), (int)count,
+                            instanceMatrices, groupSize, m_clipVertices.x.data(),
+                            m_clipVertices.y.data(), m_clipVertices.z.data(),
+                            m_clipVertices.w.data(), m_clipVertices.rhw.data(),
+                            m_clipVertices.outcode.data());
+                        drawGroup(model, first, groupSize, count);
+                    }
+                }
+            };
+            auto drawInstance = [&](const Model& model, size_t index, int k, size_t count) {
+                const SceneNode* node   = instances[index];
+                object.model            = &model;
+                object.world            = node->WorldTransform();
+                object.normal           = node->NormalMatrix();
+                object.color            = node->InstanceColor();
+                object.clipOffset       = (size_t)k * count;
+                const uint8_t* outcode  = m_clipVertices.outcode.data() + object.clipOffset;
+                auto           vertices = model.vertices();
+                auto           indices  = model.indices(lods[index]);
+                for (size_t i = 0; i < indices.size(); i += 3) {
+                    if (outcode[indices[i]] | outcode[indices[i + 1]] | outcode[indices[i + 2]])
+                        continue;
                     for (int j = 0; j < 3; ++j) {
-                        vsInputs[j].pos    = model->vert(i, j);
-                        vsInputs[j].uv     = model->uv(i, j);
-                        vsInputs[j].normal = model->normal(i, j);
+                        const MeshVertex& vertex = vertices[indices[i + j]];
+                        vsInputs[j].pos          = vertex.pos;
+                        vsInputs[j].uv           = vertex.uv;
+                        vsInputs[j].normal       = vertex.normal;
+                        vsInputs[j].index        = indices[i + j];
                     }
                     DrawPrimitive(vsInputs);
                 }
-                RenderPresent();
-                SDL_Delay(1000 / 60);
+            };
+
+            if (reuse == FrameReuse::Reproject) {
+                // 先得到这一帧完整的深度，才能判断哪些像素可以从上一帧复用
+                SetPipelineState(depthState);
+                SetVertexShader(depthVertexShader);
+                drawGroups([&](const Model& model, size_t first, int groupSize, size_t count) {
+                    for (int k = 0; k < groupSize; k++)
+                        drawInstance(model, first + k, k, count);
+                });
+                ReprojectHistory();
             }
+
+            // 每组每个方向光一个 pass，只更新参数块中的光照部分
+            // 没有方向光时也要绘制一遍，写入深度、环境光和局部光源
+            SetVertexShader(litVertexShader);
+            SetPixelShader(litPixelShader);
+            size_t passCount = Max(directionalLights.size(), (size_t)1);
+            drawGroups([&](const Model& model, size_t first, int groupSize, size_t count) {
+                for (size_t pass = 0; pass < passCount; pass++) {
+                    BasicLight* light =
+                        pass < directionalLights.size() ? directionalLights[pass].get() : nullptr;
+                    bool firstPass = pass == 0;
+                    SetPipelineState(firstPass ? opaqueState : additiveState);
+                    frame.hasLight = light != nullptr;
+                    if (light) {
+                        frame.lightDir   = vector_normalize(light->GetLightDir());
+                        frame.lightColor = light->GetLightColor();
+                    }
+                    frame.shadowMap =
+                        light && light->CastShadow() ? &m_shadowMaps[light] : nullptr;
+                    // 环境光只算一次
+                    frame.ambient     = firstPass ? 0.1f : 0.0f;
+                    frame.localLights = firstPass;
+                    for (int k = 0; k < groupSize; k++)
+                        drawInstance(model, first + k, k, count);
+                }
+            });
+            RenderPresent();
         }
+        std::chrono::duration<float, std::milli> frameTime =
+            std::chrono::steady_clock::now() - frameStart;
+        UpdateRenderScale(frameTime.count());
+        SDL_Delay(1000 / 60);
     }
+    SetUniforms(nullptr, nullptr);
 }
-ShaderContext Renderer::BarycentricInterplate(std::span<Vertex, 3> vertices,
-                                              const Vec3f&         barycentric) {
-    ShaderContext  ret;
-    ShaderContext& s0 = vertices[0].context;
-    ShaderContext& s1 = vertices[1].context;
-    ShaderContext& s2 = vertices[2].context;
-
-    std::array<float, 3> interplate_factor{barycentric.x, barycentric.y, barycentric.z};
+// 用包围球估算模型在屏幕上的面积，选择三角形数不超过预算的最精细 LOD
+uint32_t Renderer::SelectLod(const SceneNode& node, const Camera& camera) const {
+    const Model& model    = *node.GetModel();
+    float        radius   = node.WorldRadius();
+    float        distance = vector_length(node.WorldCenter() - camera.Eye());
+    if (distance <= radius) return 0;
 
-    for (const auto& [key, value] : s0.varyingVec4f) {
-        Vec4f factor_0        = value * interplate_factor[0];
-        Vec4f factor_1        = s1.varyingVec4f[key] * interplate_factor[1];
-        Vec4f factor_2        = s2.varyingVec4f[key] * interplate_factor[2];
-        ret.varyingVec4f[key] = factor_0 + factor_1 + factor_2;
-    }
+    // 投影半径（像素）= 半径 / (距离 * tan(fovy / 2)) * 屏幕高度的一半
+    float projected =
+        radius / (distance * tanf(camera.Fovy() * 0.5f)) * (m_renderHeight * 0.5f);
+    float budget    = 3.1415926f * projected * projected * LOD_TRIANGLES_PER_PIXEL;
+    uint32_t level  = 0;
+    while (level + 1 < model.lodCount() && model.indices(level).size() / 3 > budget)
+        level++;
+    return level;
+}
 
-    for (const auto& [key, value] : s0.varyingVec3f) {
-        Vec3f factor_0        = value * interplate_factor[0];
-        Vec3f factor_1        = s1.varyingVec3f[key] * interplate_factor[1];
-        Vec3f factor_2        = s2.varyingVec3f[key] * interplate_factor[2];
-        ret.varyingVec3f[key] = factor_0 + factor_1 + factor_2;
-    }
+// 每种 varying 的槽位是连续的 float，整段插值
+template <typename T>
+static void InterplateSlots(const KernelTable& kernels, const VaryingSlots<T>& s0,
+                            const VaryingSlots<T>& s1, const VaryingSlots<T>& s2,
+                            const Vec3f& barycentric, VaryingSlots<T>& output) {
+    constexpr int components = sizeof(T) / sizeof(float);
+    kernels.interpolate(reinterpret_cast<const float*>(s0.values.data()),
+                        reinterpret_cast<const float*>(s1.values.data()),
+                        reinterpret_cast<const float*>(s2.values.data()), barycentric.x,
+                        barycentric.y, barycentric.z, s0.End() * components,
+                        reinterpret_cast<float*>(output.values.data()));
+    output.used = s0.used;
+}
 
-    for (const auto& [key, value] : s0.varyingVec2f) {
-        Vec2f factor_0        = value * interplate_factor[0];
-        Vec2f factor_1        = s1.varyingVec2f[key] * interplate_factor[1];
-        Vec2f factor_2        = s2.varyingVec2f[key] * interplate_factor[2];
-        ret.varyingVec2f[key] = factor_0 + factor_1 + factor_2;
-    }
+void Renderer::BarycentricInterplate(std::span<Vertex, 3> vertices, const Vec3f& barycentric,
+                                     ShaderContext& output) {
+    ShaderContext& s0 = vertices[0].context;
+    ShaderContext& s1 = vertices[1].context;
+    ShaderContext& s2 = vertices[2].context;
 
-    for (const auto& [key, value] : s0.varyingFloat) {
-        float factor_0        = value * interplate_factor[0];
-        float factor_1        = s1.varyingFloat[key] * interplate_factor[1];
-        float factor_2        = s2.varyingFloat[key] * interplate_factor[2];
-        ret.varyingFloat[key] = factor_0 + factor_1 + factor_2;
-    }
-    return ret;
+    InterplateSlots(m_kernels, s0.varyingVec4f, s1.varyingVec4f, s2.varyingVec4f, barycentric,
+                    output.varyingVec4f);
+    InterplateSlots(m_kernels, s0.varyingVec3f, s1.varyingVec3f, s2.varyingVec3f, barycentric,
+                    output.varyingVec3f);
+    InterplateSlots(m_kernels, s0.varyingVec2f, s1.varyingVec2f, s2.varyingVec2f, barycentric,
+                    output.varyingVec2f);
+    InterplateSlots(m_kernels, s0.varyingFloat, s1.varyingFloat, s2.varyingFloat, barycentric,
+                    output.varyingFloat);
 }
 
 void Renderer::DrawPrimitive(std::span<VertexAttrib, 3> vertexAttributes) {
-    if (m_vertexShader == nullptr || m_pixelShader == nullptr) return;
+    if (m_vertexShader == nullptr) return;
+    if (m_pipelineState.colorWrite && m_pixelShader == nullptr) return;
     std::array<Vertex, 3> vertices;
-    int                   width = m_windowWidth, height = m_windowHeight;
+    int                   width = m_renderWidth, height = m_renderHeight;
     int                   min_x, max_x, min_y, max_y;
 
     for (int i : std::ranges::views::iota(0, 3)) {
         vertices[i].context.Clear();
+        vertices[i].context.frame  = m_frameUniforms;
+        vertices[i].context.object = m_objectUniforms;
         // 运行Vertex Shader
         vertices[i].pos = m_vertexShader(vertexAttributes[i], vertices[i].context);
 
@@ -173,9 +405,12 @@ void Renderer::DrawPrimitive(std::span<VertexAttrib, 3> vertexAttributes) {
     Vec4f v02    = vertices[2].pos - vertices[0].pos;
     Vec4f normal = vector_cross(v01, v02);
 
-    if (normal.z > 0.0f) { std::swap(vertices[2], vertices[1]); }
-
     if (normal.z == 0.0f) return;
+    // normal.z > 0 的是背面
+    if (m_pipelineState.cullMode == CullMode::Back && normal.z > 0.0f) return;
+    if (m_pipelineState.cullMode == CullMode::Front && normal.z < 0.0f) return;
+
+    if (normal.z > 0.0f) { std::swap(vertices[2], vertices[1]); }
     Vec2i p0 = vertices[0].spi;
     Vec2i p1 = vertices[1].spi;
     Vec2i p2 = vertices[2].spi;
@@ -187,85 +422,813 @@ void Renderer::DrawPrimitive(std::span<VertexAttrib, 3> vertexAttributes) {
     bool TopLeft12 = IsTopLeft(p1, p2);
     bool TopLeft20 = IsTopLeft(p2, p0);
 
-#pragma omp parallel for
-    // 迭代三角形外接矩形的所有点
-    auto horizontalRange = std::ranges::views::iota(min_x, max_x + 1);
-    auto verticalRange   = std::ranges::views::iota(min_y, max_y + 1);
-    for (int cy : verticalRange) {
-        // 利于并行化STL foreach 进行加速
-        std::for_each(
-            std::execution::par, horizontalRange.begin(), horizontalRange.end(), [&](int cx) {
-                Vec2f px = {(float)cx + 0.5f, (float)cy + 0.5f};
-                // Edge Equation
-                // 使用整数避免浮点误差，同时因为是左手系，所以符号取反
-                int E01 = -(cx - p0.x) * (p1.y - p0.y) + (cy - p0.y) * (p1.x - p0.x);
-                int E12 = -(cx - p1.x) * (p2.y - p1.y) + (cy - p1.y) * (p2.x - p1.x);
-                int E20 = -(cx - p2.x) * (p0.y - p2.y) + (cy - p2.y) * (p0.x - p2.x);
-
-                // 如果是左上边，用 E >= 0 判断合法，如果右下边就用 E > 0
-                // 判断合法 这里通过引入一个误差 1 ，来将 < 0 和 <= 0
-                // 用一个式子表达
-                if (E01 < (TopLeft01 ? 0 : 1)) return; // 在第一条边后面
-                if (E12 < (TopLeft12 ? 0 : 1)) return; // 在第二条边后面
-                if (E20 < (TopLeft20 ? 0 : 1)) return; // 在第三条边后面
-
-                // 三个端点到当前点的矢量
-                Vec2f s0 = vertices[0].spf - px;
-                Vec2f s1 = vertices[1].spf - px;
-                Vec2f s2 = vertices[2].spf - px;
-
-                // 重心坐标系：计算内部子三角形面积 a / b / c
-                float a = Abs(vector_cross(s1, s2)); // 子三角形 Px-P1-P2 面积
-                float b = Abs(vector_cross(s2, s0)); // 子三角形 Px-P2-P0 面积
-                float c = Abs(vector_cross(s0, s1)); // 子三角形 Px-P0-P1 面积
-                s       = a + b + c;                 // 大三角形 P0-P1-P2 面积
-
-                if (s == 0.0f) return;
-
-                // 除以总面积，以保证：a + b + c = 1，方便用作插值系数
-                a = a * (1.0f / s);
-                b = b * (1.0f / s);
-                c = c * (1.0f / s);
-
-                // 计算当前点的 1/w，因 1/w 和屏幕空间呈线性关系，故直接重心插值
-                // 因为透视投影最后一步会除以w
-                float rhw = vertices[0].rhw * a + vertices[1].rhw * b + vertices[2].rhw * c;
-
-                // 进行深度测试 pre-z
-                if (rhw < m_depthBuffer[cy * m_windowWidth + cx]) return;
-                m_depthBuffer[cy * m_windowWidth + cx] = rhw; // 记录 1/w 到深度缓存
-
-                // 还原当前像素的 w
-                float w = 1.0f / ((rhw != 0.0f) ? rhw : 1.0f);
-
-                // 计算三个顶点插值 varying 的系数
-                // 先除以各自顶点的 w 然后进行屏幕空间插值然后再乘以当前 w
-                // 已经经过透视校正
-                float c0 = vertices[0].rhw * a * w;
-                float c1 = vertices[1].rhw * b * w;
-                float c2 = vertices[2].rhw * c * w;
-
-                ShaderContext input = BarycentricInterplate(vertices, Vec3f{c0, c1, c2});
+    TriangleSetup setup;
+    setup.p[0] = p0;
+    setup.p[1] = p1;
+    setup.p[2] = p2;
+    // 边函数沿 x 方向每前进一个像素的增量
+    // 使用整数避免浮点误差，同时因为是左手系，所以符号取反
+    setup.step[0] = -(p1.y - p0.y);
+    setup.step[1] = -(p2.y - p1.y);
+    setup.step[2] = -(p0.y - p2.y);
+    // 如果是左上边，用 E >= 0 判断合法，如果右下边就用 E > 0 判断合法
+    setup.bias[0] = TopLeft01 ? 0 : 1;
+    setup.bias[1] = TopLeft12 ? 0 : 1;
+    setup.bias[2] = TopLeft20 ? 0 : 1;
+    setup.minX    = min_x;
+    setup.maxX    = max_x;
+    setup.minY    = min_y;
+    setup.maxY    = max_y;
+    m_drawId++;
+    (this->*m_rasterizer)(vertices, setup);
+}
+
+// 粗粒度着色时，同一个三角形在同一个 2x2 / 4x4 块内只在第一个覆盖的像素上执行像素着色器，
+// 块内其他像素直接复用结果
+Vec4f Renderer::ShadePixel(std::span<Vertex, 3> vertices, int x, int y, const Vec3f& barycentric,
+                           ShaderContext& input) {
+    uint32_t shift = 0;
+    if (m_coarseShading) {
+        uint32_t tileRate = m_tileShadingRate[(y >> 3) * m_colorBuffer.TilesX() + (x >> 3)];
+        shift             = Max((uint32_t)m_pipelineState.shadingRate, tileRate);
+    }
+    input.fragCoord = Vec2i(x, y);
+    input.frame     = m_frameUniforms;
+    input.object    = m_objectUniforms;
+    if (shift == 0) {
+        BarycentricInterplate(vertices, barycentric, input);
+        return m_pixelShader(input);
+    }
+
+    int      block = x >> shift;
+    uint64_t tag   = ((uint64_t)m_drawId << 32) | ((uint32_t)(y >> shift) << 2) | shift;
+    if (m_span.blockTag[block] != tag) {
+        BarycentricInterplate(vertices, barycentric, input);
+        m_span.blockColor[block] = m_pixelShader(input);
+        m_span.blockTag[block]   = tag;
+    }
+    return m_span.blockColor[block];
+}
+
+// 光源包围球投影到屏幕的外接矩形：观察空间包围盒的角点分别投影，结果是保守的
+void Renderer::CullLights(std::span<const LocalLight> lights, const Mat4x4f& matView,
+                          const Mat4x4f& matProj) {
+    int tileSize  = 1 << LIGHT_TILE_SHIFT;
+    m_lightTilesX = (m_renderWidth + tileSize - 1) >> LIGHT_TILE_SHIFT;
+    m_lightTilesY = (m_renderHeight + tileSize - 1) >> LIGHT_TILE_SHIFT;
+    m_localLights.assign(lights.begin(), lights.end());
+    m_lightTileRects.resize(lights.size());
+    m_lightTileOffsets.assign((size_t)m_lightTilesX * m_lightTilesY + 1, 0);
+
+    // 近平面 zn 满足 zn * m22 + m32 = 0
+    float nearZ = -matProj.m[3][2] / matProj.m[2][2];
+    for (size_t i = 0; i < lights.size(); i++) {
+        const LocalLight&   light = lights[i];
+        std::array<int, 4>& rect  = m_lightTileRects[i];
+        Vec3f               c     = (light.position.xyz1() * matView).xyz();
+        float               r     = light.range;
+        rect                      = {0, 0, -1, -1};
+        if (c.z + r <= nearZ) continue; // 整个在相机后面
+
+        float minX = -1.0f, maxX = 1.0f, minY = -1.0f, maxY = 1.0f;
+        // 和近平面相交时透视除法没有意义，保守地覆盖整个屏幕
+        if (c.z - r > nearZ) {
+            minX = minY = FLT_MAX;
+            maxX = maxY = -FLT_MAX;
+            for (float dz : {-r, r}) {
+                for (float dx : {-r, r}) {
+                    float x = (c.x + dx) * matProj.m[0][0] / (c.z + dz);
+                    minX    = Min(minX, x);
+                    maxX    = Max(maxX, x);
+                }
+                for (float dy : {-r, r}) {
+                    float y = (c.y + dy) * matProj.m[1][1] / (c.z + dz);
+                    minY    = Min(minY, y);
+                    maxY    = Max(maxY, y);
+                }
+            }
+            if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f) continue;
+        }
+        // NDC 的 y 向上，屏幕的 y 向下
+        int x0 = (int)floorf((Max(minX, -1.0f) + 1.0f) * 0.5f * m_renderWidth) >> LIGHT_TILE_SHIFT;
+        int x1 = (int)floorf((Min(maxX, 1.0f) + 1.0f) * 0.5f * m_renderWidth) >> LIGHT_TILE_SHIFT;
+        int y0 = (int)floorf((1.0f - Min(maxY, 1.0f)) * 0.5f * m_renderHeight) >> LIGHT_TILE_SHIFT;
+        int y1 = (int)floorf((1.0f - Max(minY, -1.0f)) * 0.5f * m_renderHeight) >> LIGHT_TILE_SHIFT;
+        rect   = {Between(0, m_lightTilesX - 1, x0), Between(0, m_lightTilesY - 1, y0),
+                  Between(0, m_lightTilesX - 1, x1), Between(0, m_lightTilesY - 1, y1)};
+        for (int ty = rect[1]; ty <= rect[3]; ty++) {
+            for (int tx = rect[0]; tx <= rect[2]; tx++)
+                m_lightTileOffsets[(size_t)ty * m_lightTilesX + tx + 1]++;
+        }
+    }
+
+    // 计数的前缀和就是每个块在索引数组中的起点，再按同样的顺序填一遍
+    for (size_t t = 1; t < m_lightTileOffsets.size(); t++)
+        m_lightTileOffsets[t] += m_lightTileOffsets[t - 1];
+    m_lightTileIndices.resize(m_lightTileOffsets.back());
+    std::vector<uint32_t>& cursor = m_lightTileCursor;
+    cursor.assign(m_lightTileOffsets.begin(), m_lightTileOffsets.end() - 1);
+    for (size_t i = 0; i < lights.size(); i++) {
+        const std::array<int, 4>& rect = m_lightTileRects[i];
+        for (int ty = rect[1]; ty <= rect[3]; ty++) {
+            for (int tx = rect[0]; tx <= rect[2]; tx++)
+                m_lightTileIndices[cursor[(size_t)ty * m_lightTilesX + tx]++] = (uint32_t)i;
+        }
+    }
+}
+
+std::span<const uint32_t> Renderer::TileLights(const Vec2i& fragCoord) const {
+    if (m_lightTileIndices.empty()) return {};
+    size_t tile = (size_t)(fragCoord.y >> LIGHT_TILE_SHIFT) * m_lightTilesX +
+                  (fragCoord.x >> LIGHT_TILE_SHIFT);
+    return std::span<const uint32_t>(m_lightTileIndices.data() + m_lightTileOffsets[tile],
+                                     m_lightTileOffsets[tile + 1] - m_lightTileOffsets[tile]);
+}
+
+// 阴影贴图只需要深度：模型位置批量变换到光源空间后直接光栅化，不运行顶点着色器，没有 varying 和像素着色器
+bool Renderer::RenderShadowMap(ShadowMap& shadowMap, const Vec3f& lightDir,
+                               std::span<const SceneNode* const> casters, uint64_t signature) {
+    shadowMap.Resize(SHADOW_MAP_SIZE);
+    if (shadowMap.m_signature == signature) return false;
+    shadowMap.m_signature = signature;
+    shadowMap.m_depth.Clear(1.0f);
+    if (casters.empty()) return true;
+
+    // 包住所有物体包围球的球，正交投影的范围和深度都取它的直径
+    Vec3f minPos(FLT_MAX, FLT_MAX, FLT_MAX), maxPos(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const SceneNode* caster : casters) {
+        Vec3f extent(caster->WorldRadius(), caster->WorldRadius(), caster->WorldRadius());
+        minPos = vector_min(minPos, caster->WorldCenter() - extent);
+        maxPos = vector_max(maxPos, caster->WorldCenter() + extent);
+    }
+    Vec3f center = (minPos + maxPos) * 0.5f;
+    float radius = 0.0f;
+    for (const SceneNode* caster : casters)
+        radius = Max(radius, vector_length(caster->WorldCenter() - center) + caster->WorldRadius());
+    if (radius <= 0.0f) return true;
+
+    Vec3f   dir  = vector_normalize(lightDir);
+    Vec3f   up   = Abs(dir.y) > 0.99f ? Vec3f(1.0f, 0.0f, 0.0f) : Vec3f(0.0f, 1.0f, 0.0f);
+    Mat4x4f view = matrix_set_lookat(center + dir * radius, center, up);
+    Mat4x4f proj = matrix_set_ortho(radius * 2.0f, radius * 2.0f, 0.0f, radius * 2.0f);
+    shadowMap.m_viewProj = view * proj;
+
+    float size = (float)shadowMap.Size();
+    for (const SceneNode* caster : casters) {
+        const Model&    model     = *caster->GetModel();
+        const Vec3fSoA& positions = model.positionStream();
+        Mat4x4f         mvp       = caster->WorldTransform() * shadowMap.m_viewProj;
+        m_clipVertices.resize(positions.size());
+        m_kernels.transformPositions(positions.x.data(), positions.y.data(), positions.z.data(),
+                                     (int)positions.size(), mvp.m, m_clipVertices.x.data(),
+                                     m_clipVertices.y.data(), m_clipVertices.z.data(),
+                                     m_clipVertices.w.data(), m_clipVertices.rhw.data(),
+                                     m_clipVertices.outcode.data());
+        // 阴影不随相机变化，始终使用最精细的 LOD
+        auto           indices = model.indices(0);
+        const uint8_t* outcode = m_clipVertices.outcode.data();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            uint32_t i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+            if (outcode[i0] | outcode[i1] | outcode[i2]) continue;
+            Vec3f v[3];
+            for (int j = 0; j < 3; j++) {
+                uint32_t k = indices[i + j];
+                float    r = m_clipVertices.rhw[k];
+                v[j]       = Vec3f((m_clipVertices.x[k] * r + 1.0f) * 0.5f * size,
+                                   (1.0f - m_clipVertices.y[k] * r) * 0.5f * size,
+                                   m_clipVertices.z[k] * r);
+            }
+            RasterizeShadowTriangle(shadowMap.m_depth, v);
+        }
+    }
+    return true;
+}
+
+// 只画背对光源的面：深度取物体的背面，向光的表面和自己的深度差很大，不会出现自阴影的条纹
+void Renderer::RasterizeShadowTriangle(DepthBuffer& depth, Vec3f (&v)[3]) {
+    // 屏幕坐标 y 向下，面积为正的是正面；背面交换两个顶点，下面统一按正面积处理
+    float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+    if (area >= 0.0f) return;
+    std::swap(v[1], v[2]);
+    area = -area;
+
+    int minX = Max(0, (int)floorf(Min(Min(v[0].x, v[1].x), v[2].x)));
+    int maxX = Min(depth.Width() - 1, (int)ceilf(Max(Max(v[0].x, v[1].x), v[2].x)));
+    int minY = Max(0, (int)floorf(Min(Min(v[0].y, v[1].y), v[2].y)));
+    int maxY = Min(depth.Height() - 1, (int)ceilf(Max(Max(v[0].y, v[1].y), v[2].y)));
+    if (minX > maxX || minY > maxY) return;
+
+    // 深度在屏幕空间是线性的：z = z0 + dzdx * (x - x0) + dzdy * (y - y0)
+    float dz1  = v[1].z - v[0].z, dz2 = v[2].z - v[0].z;
+    float dzdx = (dz1 * (v[2].y - v[0].y) - dz2 * (v[1].y - v[0].y)) / area;
+    float dzdy = (dz2 * (v[1].x - v[0].x) - dz1 * (v[2].x - v[0].x)) / area;
+
+    // 边函数在像素中心取值，三个都不小于 0 的像素被覆盖；共享边上的像素可能写两次，对深度没有影响
+    float edgeStep[3], edgeRow[3];
+    float px = minX + 0.5f, py = minY + 0.5f;
+    for (int i = 0; i < 3; i++) {
+        const Vec3f& a = v[i];
+        const Vec3f& b = v[(i + 1) % 3];
+        edgeStep[i]    = a.y - b.y;
+        edgeRow[i]     = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+    }
+    float zRow = v[0].z + dzdx * (px - v[0].x) + dzdy * (py - v[0].y);
+    for (int y = minY; y <= maxY; y++) {
+        depth.Touch(minX, maxX, y);
+        float* row = depth.Data() + depth.RowOffset(y);
+        float  e0 = edgeRow[0], e1 = edgeRow[1], e2 = edgeRow[2], z = zRow;
+        for (int x = minX; x <= maxX; x++) {
+            if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                float& d = row[DepthBuffer::ColumnOffset(x)];
+                if (z < d) d = z;
+            }
+            e0 += edgeStep[0];
+            e1 += edgeStep[1];
+            e2 += edgeStep[2];
+            z += dzdx;
+        }
+        edgeRow[0] += v[1].x - v[0].x;
+        edgeRow[1] += v[2].x - v[1].x;
+        edgeRow[2] += v[0].x - v[2].x;
+        zRow += dzdy;
+    }
+}
+
+void Renderer::SetTileShadingRate(int tileX, int tileY, ShadingRate rate) {
+    m_tileShadingRate[tileY * m_colorBuffer.TilesX() + tileX] = (uint8_t)rate;
+    UpdateCoarseShading();
+}
+
+void Renderer::SetAdaptiveShading(bool enable, float threshold) {
+    m_adaptiveShading   = enable;
+    m_adaptiveThreshold = threshold;
+    if (!enable) std::fill(m_tileShadingRate.begin(), m_tileShadingRate.end(), 0);
+    UpdateCoarseShading();
+}
+
+void Renderer::UpdateCoarseShading() {
+    m_coarseShading = m_pipelineState.shadingRate != ShadingRate::Rate1x1 ||
+                      std::any_of(m_tileShadingRate.begin(), m_tileShadingRate.end(),
+                                  [](uint8_t rate) { return rate != 0; });
+}
+
+// 按上一帧每个 8x8 块内相邻像素的最大亮度差选择着色率：平坦的块用 4x4，变化小的块用 2x2
+// pixels 是内部分辨率下解析后的颜色
+void Renderer::UpdateAdaptiveShadingRates(const uint32_t* pixels) {
+    int tilesX = m_colorBuffer.TilesX();
+    int tilesY = (m_renderHeight + 7) >> 3;
+    auto luminance = [](uint32_t c) {
+        return (0.299f * ((c >> 16) & 0xff) + 0.587f * ((c >> 8) & 0xff) + 0.114f * (c & 0xff)) *
+               (1.0f / 255.0f);
+    };
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < (m_renderWidth + 7) >> 3; tx++) {
+            int   x0 = tx * 8, y0 = ty * 8;
+            int   x1 = Min(x0 + 8, m_renderWidth), y1 = Min(y0 + 8, m_renderHeight);
+            float gradient = 0.0f;
+            for (int y = y0; y < y1; y++) {
+                const uint32_t* row = pixels + (size_t)y * m_renderWidth;
+                for (int x = x0; x < x1; x++) {
+                    float l = luminance(row[x]);
+                    if (x + 1 < x1) gradient = Max(gradient, Abs(luminance(row[x + 1]) - l));
+                    if (y + 1 < y1)
+                        gradient = Max(gradient, Abs(luminance(row[x + m_renderWidth]) - l));
+                }
+            }
+            ShadingRate rate = ShadingRate::Rate1x1;
+            if (gradient < m_adaptiveThreshold * 0.25f) rate = ShadingRate::Rate4x4;
+            else if (gradient < m_adaptiveThreshold) rate = ShadingRate::Rate2x2;
+            m_tileShadingRate[ty * tilesX + tx] = (uint8_t)rate;
+        }
+    }
+    UpdateCoarseShading();
+}
+
+// 按行迭代三角形外接矩形：先求整行的覆盖和重心坐标，再逐像素做深度测试和着色
+// Key 是 PipelineState::RasterKey()，关掉的功能在编译期就被去掉
+template <uint32_t Key>
+void Renderer::RasterizeTriangle(std::span<Vertex, 3> vertices, const TriangleSetup& setup) {
+    constexpr bool      depthTest   = Key & PIPELINE_DEPTH_TEST;
+    constexpr bool      depthWrite  = Key & PIPELINE_DEPTH_WRITE;
+    constexpr bool      colorWrite  = Key & PIPELINE_COLOR_WRITE;
+    constexpr bool      perspective = Key & PIPELINE_PERSPECTIVE;
+    constexpr BlendMode blendMode   = (BlendMode)(Key >> PIPELINE_BLEND_SHIFT);
+
+    float spx[3], spy[3], rhw[3];
+    for (int i = 0; i < 3; i++) {
+        spx[i] = vertices[i].spf.x;
+        spy[i] = vertices[i].spf.y;
+        rhw[i] = vertices[i].rhw;
+    }
+
+    const Vec2i&  p0    = setup.p[0];
+    const Vec2i&  p1    = setup.p[1];
+    const Vec2i&  p2    = setup.p[2];
+    int           min_x = setup.minX;
+    int           count = setup.maxX - setup.minX + 1;
+    SpanBuffer&   span  = m_span;
+    ShaderContext input;
+    for (int cy = setup.minY; cy <= setup.maxY; cy++) {
+        int32_t e[3] = {
+            -(min_x - p0.x) * (p1.y - p0.y) + (cy - p0.y) * (p1.x - p0.x),
+            -(min_x - p1.x) * (p2.y - p1.y) + (cy - p1.y) * (p2.x - p1.x),
+            -(min_x - p2.x) * (p0.y - p2.y) + (cy - p2.y) * (p0.x - p2.x),
+        };
+        if (m_kernels.edgeCoverage(e, setup.step, setup.bias, count, span.mask.data()) == 0)
+            continue;
+
+        // 只处理第一个到最后一个覆盖像素之间的部分
+        int first = 0, last = count - 1;
+        while (!span.mask[first])
+            first++;
+        while (!span.mask[last])
+            last--;
+        int length = last - first + 1;
+
+        // 计算每个像素的 1/w 和插值系数
+        m_kernels.barycentricSpan(spx, spy, rhw, min_x + first, cy, length,
+                                  span.mask.data() + first, span.rhw.data() + first,
+                                  span.w0.data() + first, span.w1.data() + first,
+                                  span.w2.data() + first, perspective);
+
+        // 这一段经过的块如果还没被写过，先填充清除值
+        if constexpr (depthTest || depthWrite)
+            m_depthBuffer.Touch(min_x + first, min_x + last, cy);
+        if constexpr (colorWrite) m_colorBuffer.Touch(min_x + first, min_x + last, cy);
+
+        // 深度和颜色缓冲按块存储且布局相同，同一像素的下标也相同
+        float*         depthRow = m_depthBuffer.Data() + m_depthBuffer.RowOffset(cy);
+        Vec4f*         colorRow = m_colorBuffer.Data() + m_colorBuffer.RowOffset(cy);
+        const uint8_t* reuseRow =
+            m_reprojecting ? m_reuseMask.Data() + m_reuseMask.RowOffset(cy) : nullptr;
+        for (int i = first; i <= last; i++) {
+            if (!span.mask[i]) continue;
+            size_t p = DepthBuffer::ColumnOffset(min_x + i);
+            // 进行深度测试 pre-z
+            if constexpr (depthTest) {
+                if (span.rhw[i] < depthRow[p]) {
+                    span.mask[i] = 0;
+                    continue;
+                }
+            }
+            if constexpr (depthWrite) depthRow[p] = span.rhw[i]; // 记录 1/w 到深度缓存
+
+            if constexpr (colorWrite) {
+                // 从上一帧重投影过来的像素不再着色
+                if (reuseRow && reuseRow[p]) continue;
                 // 执行像素着色器
-                Vec4f color = {0.0f, 0.0f, 0.0f, 0.0f};
-                color       = m_pixelShader(input);
-                DrawPixel(cx, cy, color);
-            });
+                Vec4f color = ShadePixel(vertices, min_x + i, cy,
+                                         Vec3f{span.w0[i], span.w1[i], span.w2[i]}, input);
+                // 颜色缓冲是浮点的，混合不需要先解包，也不会在多次叠加之间截断
+                if constexpr (blendMode == BlendMode::Additive) {
+                    colorRow[p] = colorRow[p] + color;
+                } else if constexpr (blendMode == BlendMode::Alpha) {
+                    colorRow[p] = color * color.a + colorRow[p] * (1.0f - color.a);
+                } else {
+                    colorRow[p] = color;
+                }
+            }
+        }
+    }
+}
+
+// 4x MSAA 的采样点，单位是 1/16 像素，相对像素中心（旋转网格）
+constexpr int SUBPIXEL_SCALE                  = 16;
+constexpr int MSAA_OFFSETS[MSAA_SAMPLES][2] = {{-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+constexpr int MSAA_FULL_COVERAGE            = (1 << MSAA_SAMPLES) - 1;
+
+template <BlendMode Blend> static void BlendColor(Vec4f& dst, const Vec4f& src) {
+    if constexpr (Blend == BlendMode::Additive) {
+        dst = dst + src;
+    } else if constexpr (Blend == BlendMode::Alpha) {
+        dst = src * src.a + dst * (1.0f - src.a);
+    } else {
+        dst = src;
     }
 }
 
+// 覆盖和深度按 4 个采样点计算，像素着色器每个覆盖的像素只在像素中心执行一次
+// 顶点使用 4 位小数的定点坐标，而不是吸附到整数像素
+template <uint32_t Key>
+void Renderer::RasterizeTriangleMsaa(std::span<Vertex, 3> vertices, const TriangleSetup&) {
+    constexpr bool      depthTest   = Key & PIPELINE_DEPTH_TEST;
+    constexpr bool      depthWrite  = Key & PIPELINE_DEPTH_WRITE;
+    constexpr bool      colorWrite  = Key & PIPELINE_COLOR_WRITE;
+    constexpr bool      perspective = Key & PIPELINE_PERSPECTIVE;
+    constexpr BlendMode blendMode   = (BlendMode)(Key >> PIPELINE_BLEND_SHIFT);
+
+    float   spx[3], spy[3], rhw[3];
+    int64_t qx[3], qy[3];
+    for (int i = 0; i < 3; i++) {
+        spx[i] = vertices[i].spf.x;
+        spy[i] = vertices[i].spf.y;
+        rhw[i] = vertices[i].rhw;
+        qx[i]  = (int64_t)lroundf(spx[i] * SUBPIXEL_SCALE);
+        qy[i]  = (int64_t)lroundf(spy[i] * SUBPIXEL_SCALE);
+    }
+
+    // 边 k 从顶点 k 指向顶点 k + 1，内部的点满足 E_k >= bias_k，和整数像素的版本相同
+    int64_t dx[3], dy[3], bias[3];
+    for (int k = 0; k < 3; k++) {
+        int j   = (k + 1) % 3;
+        dx[k]   = qx[j] - qx[k];
+        dy[k]   = qy[j] - qy[k];
+        bias[k] = IsTopLeft(Vec2i((int)qx[k], (int)qy[k]), Vec2i((int)qx[j], (int)qy[j])) ? 0 : 1;
+    }
+    // 定点化后退化或者翻转的细长三角形不绘制
+    if (-(qx[2] - qx[0]) * dy[0] + (qy[2] - qy[0]) * dx[0] <= 0) return;
+
+    // 1/w 在屏幕空间是线性的，用平面方程求每个采样点的值
+    float ex1 = spx[1] - spx[0], ey1 = spy[1] - spy[0];
+    float ex2 = spx[2] - spx[0], ey2 = spy[2] - spy[0];
+    float det = ex1 * ey2 - ex2 * ey1;
+    if (det == 0.0f) return;
+    float dRdx = ((rhw[1] - rhw[0]) * ey2 - (rhw[2] - rhw[0]) * ey1) / det;
+    float dRdy = ((rhw[2] - rhw[0]) * ex1 - (rhw[1] - rhw[0]) * ex2) / det;
+
+    // 每个采样点相对像素中心的边函数和 1/w 偏移
+    int64_t edgeOffset[3][MSAA_SAMPLES];
+    float   rhwOffset[MSAA_SAMPLES];
+    for (int s = 0; s < MSAA_SAMPLES; s++) {
+        int ox = MSAA_OFFSETS[s][0], oy = MSAA_OFFSETS[s][1];
+        for (int k = 0; k < 3; k++)
+            edgeOffset[k][s] = -ox * dy[k] + oy * dx[k];
+        rhwOffset[s] = (dRdx * ox + dRdy * oy) * (1.0f / SUBPIXEL_SCALE);
+    }
+
+    int width = m_renderWidth, height = m_renderHeight;
+    int min_x = Between(0, width - 1, (int)floorf(Min(Min(spx[0], spx[1]), spx[2])));
+    int max_x = Between(0, width - 1, (int)floorf(Max(Max(spx[0], spx[1]), spx[2])));
+    int min_y = Between(0, height - 1, (int)floorf(Min(Min(spy[0], spy[1]), spy[2])));
+    int max_y = Between(0, height - 1, (int)floorf(Max(Max(spy[0], spy[1]), spy[2])));
+    int count = max_x - min_x + 1;
+
+    SpanBuffer&   span = m_span;
+    ShaderContext input;
+    for (int cy = min_y; cy <= max_y; cy++) {
+        // 像素中心的边函数，每向右一个像素增加 -16 * dy
+        int64_t py = (int64_t)cy * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+        int64_t px = (int64_t)min_x * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+        int64_t e[3];
+        for (int k = 0; k < 3; k++)
+            e[k] = -(px - qx[k]) * dy[k] + (py - qy[k]) * dx[k];
+
+        int first = -1, last = -1;
+        for (int i = 0; i < count; i++) {
+            uint8_t coverage = 0;
+            for (int s = 0; s < MSAA_SAMPLES; s++) {
+                bool inside = true;
+                for (int k = 0; k < 3; k++)
+                    inside &= e[k] + edgeOffset[k][s] >= bias[k];
+                coverage |= inside << s;
+            }
+            span.coverage[i] = coverage;
+            span.mask[i]     = coverage != 0;
+            if (coverage) {
+                if (first < 0) first = i;
+                last = i;
+            }
+            for (int k = 0; k < 3; k++)
+                e[k] -= dy[k] * SUBPIXEL_SCALE;
+        }
+        if (first < 0) continue;
+        int length = last - first + 1;
+
+        // 着色用像素中心的插值系数
+        m_kernels.barycentricSpan(spx, spy, rhw, min_x + first, cy, length,
+                                  span.mask.data() + first, span.rhw.data() + first,
+                                  span.w0.data() + first, span.w1.data() + first,
+                                  span.w2.data() + first, perspective);
+
+        if constexpr (depthTest || depthWrite)
+            m_sampleDepth.Touch(min_x + first, min_x + last, cy);
+        if constexpr (colorWrite) {
+            m_colorBuffer.Touch(min_x + first, min_x + last, cy);
+            m_sampleIndex.Touch(min_x + first, min_x + last, cy);
+        }
+
+        Vec4f*    depthRow = m_sampleDepth.Data() + m_sampleDepth.RowOffset(cy);
+        Vec4f*    colorRow = m_colorBuffer.Data() + m_colorBuffer.RowOffset(cy);
+        uint32_t* indexRow = m_sampleIndex.Data() + m_sampleIndex.RowOffset(cy);
+        const uint8_t* reuseRow =
+            m_reprojecting ? m_reuseMask.Data() + m_reuseMask.RowOffset(cy) : nullptr;
+        float     rhwRow   = rhw[0] + dRdy * ((float)cy + 0.5f - spy[0]);
+        for (int i = first; i <= last; i++) {
+            if (!span.mask[i]) continue;
+            size_t p         = ColorBuffer::ColumnOffset(min_x + i);
+            float  rhwCenter = rhwRow + dRdx * ((float)(min_x + i) + 0.5f - spx[0]);
+
+            // 逐采样点深度测试，通过的采样点组成 passed
+            uint32_t passed = span.coverage[i];
+            float    sampleRhw[MSAA_SAMPLES];
+            for (int s = 0; s < MSAA_SAMPLES; s++) {
+                sampleRhw[s] = rhwCenter + rhwOffset[s];
+                if constexpr (depthTest) {
+                    if (sampleRhw[s] < depthRow[p].m[s]) passed &= ~(1u << s);
+                }
+            }
+            if (passed == 0) continue;
+            if constexpr (depthWrite) {
+                for (int s = 0; s < MSAA_SAMPLES; s++) {
+                    if (passed & (1u << s)) depthRow[p].m[s] = sampleRhw[s];
+                }
+            }
+
+            if constexpr (colorWrite) {
+                if (reuseRow && reuseRow[p]) continue;
+                Vec4f     color = ShadePixel(vertices, min_x + i, cy,
+                                             Vec3f{span.w0[i], span.w1[i], span.w2[i]}, input);
+                uint32_t& index = indexRow[p];
+                if (passed == MSAA_FULL_COVERAGE && (index == 0 || blendMode == BlendMode::Opaque)) {
+                    // 整个像素被覆盖：只保存一份颜色
+                    BlendColor<blendMode>(colorRow[p], color);
+                    index = 0;
+                } else {
+                    // 部分覆盖：展开成 4 个采样颜色
+                    if (index == 0) {
+                        index = (uint32_t)m_samplePool.size();
+                        m_samplePool.emplace_back();
+                        m_samplePool.back().fill(colorRow[p]);
+                    }
+                    SampleColors& samples = m_samplePool[index];
+                    for (int s = 0; s < MSAA_SAMPLES; s++) {
+                        if (passed & (1u << s)) BlendColor<blendMode>(samples[s], color);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <size_t... Keys>
+constexpr std::array<Renderer::Rasterizer, sizeof...(Keys) * 2>
+Renderer::MakeRasterizers(std::index_sequence<Keys...>) {
+    return {&Renderer::RasterizeTriangle<(uint32_t)Keys>...,
+            &Renderer::RasterizeTriangleMsaa<(uint32_t)Keys>...};
+}
+
+void Renderer::SetPipelineState(const PipelineState& state) {
+    // 前一半是单采样的版本，后一半是 MSAA 的版本
+    static constexpr auto rasterizers =
+        MakeRasterizers(std::make_index_sequence<PIPELINE_VARIANTS>());
+    m_pipelineState = state;
+    m_rasterizer    = rasterizers[state.RasterKey() + (m_sampleCount > 1 ? PIPELINE_VARIANTS : 0)];
+    UpdateCoarseShading();
+}
+
+void Renderer::SetSampleCount(int sampleCount) {
+    m_sampleCount = (sampleCount > 1) ? MSAA_SAMPLES : 1;
+    if (m_sampleCount > 1) {
+        m_sampleDepth.Resize(m_windowWidth, m_windowHeight);
+        m_sampleIndex.Resize(m_windowWidth, m_windowHeight);
+    } else {
+        m_sampleDepth = ColorBuffer();
+        m_sampleIndex = TiledBuffer<uint32_t>();
+    }
+    m_samplePool.resize(1); // 0 号表示未分配
+    ResizeHistory();
+    SetPipelineState(m_pipelineState);
+}
+
+// 整帧只在这里做一次曝光、色调映射、钳制和打包，同时把按块存储的颜色还原成线性排列
+// 内部分辨率小于窗口时先解析到 m_scaledFrame，再双线性放大到窗口大小
 void Renderer::RenderPresent() {
+    if (m_temporalReuse) {
+        m_historyValid     = true;
+        m_historySignature = m_frameSignature;
+        m_historyViewProj  = m_frameViewProj;
+        m_reprojecting     = false;
+    }
+    bool      scaled   = m_renderWidth != m_windowWidth || m_renderHeight != m_windowHeight;
+    uint32_t* resolved = scaled ? m_scaledFrame.data() : m_frameBuffer;
+    for (int y = 0; y < m_renderHeight; y++) {
+        m_colorBuffer.ReadRow(y, m_span.color.data(), m_renderWidth);
+        if (m_sampleCount > 1) {
+            // 展开过的像素取 4 个采样颜色的平均值
+            m_sampleIndex.ReadRow(y, m_span.sampleIndex.data(), m_renderWidth);
+            for (int x = 0; x < m_renderWidth; x++) {
+                uint32_t index = m_span.sampleIndex[x];
+                if (index == 0) continue;
+                const SampleColors& samples = m_samplePool[index];
+                m_span.color[x] = ((samples[0] + samples[1]) + (samples[2] + samples[3])) * 0.25f;
+            }
+        }
+        m_kernels.resolveColors(reinterpret_cast<const float*>(m_span.color.data()),
+                                m_renderWidth, m_exposure, m_toneMapping,
+                                resolved + (size_t)y * m_renderWidth);
+    }
+    if (m_adaptiveShading) UpdateAdaptiveShadingRates(resolved);
+    if (scaled) Upscale();
     SDL_UpdateTexture(m_swapTexture, nullptr, m_frameBuffer, m_windowWidth * 4);
     SDL_RenderCopy(m_renderer, m_swapTexture, nullptr, nullptr);
     SDL_RenderPresent(m_renderer);
 }
 
+void Renderer::PresentPrevious() {
+    SDL_RenderCopy(m_renderer, m_swapTexture, nullptr, nullptr);
+    SDL_RenderPresent(m_renderer);
+}
+
+void Renderer::SetTemporalReuse(bool enable) {
+    m_temporalReuse = enable;
+    m_historyValid  = false;
+    m_reprojecting  = false;
+    ResizeHistory();
+}
+
+void Renderer::ResizeHistory() {
+    m_historyValid = false;
+    if (!m_temporalReuse) {
+        m_reuseMask          = TiledBuffer<uint8_t>();
+        m_historyColor       = ColorBuffer();
+        m_historyDepth       = DepthBuffer();
+        m_historySampleDepth = ColorBuffer();
+        m_historySampleIndex = TiledBuffer<uint32_t>();
+        return;
+    }
+    // 和当前帧的缓冲大小相同，才能直接交换
+    m_reuseMask.Resize(m_windowWidth, m_windowHeight);
+    m_historyColor.Resize(m_windowWidth, m_windowHeight);
+    m_historyDepth.Resize(m_windowWidth, m_windowHeight);
+    m_historySampleDepth.Resize(m_sampleDepth.Width(), m_sampleDepth.Height());
+    m_historySampleIndex.Resize(m_sampleIndex.Width(), m_sampleIndex.Height());
+}
+
+FrameReuse Renderer::BeginFrame(uint64_t sceneSignature, const Mat4x4f& matView,
+                                const Mat4x4f& matProj) {
+    // 加上影响最终颜色的渲染设置
+    FrameSignature signature;
+    signature.Add(sceneSignature).Add(m_renderWidth).Add(m_renderHeight).Add(m_sampleCount);
+    signature.Add(m_exposure).Add(m_toneMapping).Add(m_adaptiveShading).Add(m_adaptiveThreshold);
+    // 自适应着色率每帧由上一帧的结果决定，只有手动设置的着色率算作场景状态
+    if (!m_adaptiveShading) {
+        for (uint8_t rate : m_tileShadingRate)
+            signature.Add(rate);
+    }
+    m_frameSignature = signature.Value();
+    m_frameViewProj  = matView * matProj;
+    m_frameProj      = matProj;
+    m_reprojecting   = false;
+    m_frameIndex++;
+
+    if (!m_temporalReuse || !m_historyValid || m_frameSignature != m_historySignature)
+        return FrameReuse::None;
+    if (std::memcmp(m_frameViewProj.m, m_historyViewProj.m, sizeof(m_frameViewProj.m)) == 0)
+        return FrameReuse::Present;
+    if (m_reusedFraction < REPROJECTION_MIN_REUSE) {
+        // 这一帧完整绘制，下一帧再尝试重投影
+        m_reusedFraction = 1.0f;
+        return FrameReuse::None;
+    }
+    m_reprojecting = true;
+    return FrameReuse::Reproject;
+}
+
+// 像素的 1/w；MSAA 下 4 个采样相差太大（跨越了边缘）时返回 0，这样的像素不参与复用
+static float PixelDepth(const Vec4f& samples) {
+    float nearest  = Max(Max(samples.x, samples.y), Max(samples.z, samples.w));
+    float farthest = Min(Min(samples.x, samples.y), Min(samples.z, samples.w));
+    if (nearest - farthest > nearest * REPROJECTION_DEPTH_TOLERANCE) return 0.0f;
+    return (samples.x + samples.y + samples.z + samples.w) * 0.25f;
+}
+
+float Renderer::HistoryDepth(int x, int y) const {
+    int tx = x >> 3, ty = y >> 3;
+    if (m_sampleCount == 1) {
+        return m_historyDepth.IsTileCleared(tx, ty) ? m_historyDepth.ClearValue()
+                                                    : m_historyDepth.At(x, y);
+    }
+    if (m_historySampleDepth.IsTileCleared(tx, ty)) return 0.0f;
+    if (!m_historySampleIndex.IsTileCleared(tx, ty) && m_historySampleIndex.At(x, y) != 0)
+        return 0.0f;
+    return PixelDepth(m_historySampleDepth.At(x, y));
+}
+
+// 逆向重投影：用这一帧的深度求出每个像素在上一帧的位置，
+// 那里的深度也对得上才说明是同一个表面，直接复用上一帧的颜色
+void Renderer::ReprojectHistory() {
+    int width = m_renderWidth, height = m_renderHeight;
+    // 这一帧的 (ndc.x, ndc.y, ndc.z, 1) 乘以它得到上一帧的裁剪坐标（相差一个 w 的倍数）
+    Mat4x4f  reproject = matrix_invert(m_frameViewProj) * m_historyViewProj;
+    float    zScale = m_frameProj.m[2][2], zBias = m_frameProj.m[3][2];
+    uint32_t refresh = m_frameIndex % REPROJECTION_REFRESH_PERIOD;
+    size_t   covered = 0, reused = 0;
+    bool     msaa    = m_sampleCount > 1;
+    for (int ty = 0; ty < (height + 7) >> 3; ty++) {
+        for (int tx = 0; tx < (width + 7) >> 3; tx++) {
+            // 没有写过深度的块不会有像素通过后面的深度测试，也就不需要标记
+            if (msaa ? m_sampleDepth.IsTileCleared(tx, ty) : m_depthBuffer.IsTileCleared(tx, ty))
+                continue;
+            // 轮流强制重新着色一部分块，限制误差在多次重投影之间累积
+            bool           forceShade = (uint32_t)(tx + ty) % REPROJECTION_REFRESH_PERIOD == refresh;
+            const float*   depth      = m_depthBuffer.TileData(tx, ty);
+            const Vec4f*   samples    = msaa ? m_sampleDepth.TileData(tx, ty) : nullptr;
+            uint8_t*       mask       = m_reuseMask.TileData(tx, ty);
+            Vec4f*         color      = m_colorBuffer.TileData(tx, ty);
+            bool           touched    = false;
+            for (int i = 0; i < DepthBuffer::TILE_PIXELS; i++) {
+                int   x   = (tx << 3) + (i & 7);
+                int   y   = (ty << 3) + (i >> 3);
+                float rhw = msaa ? PixelDepth(samples[i]) : depth[i];
+                mask[i]   = 0;
+                if (rhw <= 0.0f || x >= width || y >= height) continue;
+                covered++;
+                if (forceShade) continue;
+
+                float ndcX = ((float)x + 0.5f) * 2.0f / (float)width - 1.0f;
+                float ndcY = 1.0f - ((float)y + 0.5f) * 2.0f / (float)height;
+                Vec4f prev = Vec4f(ndcX, ndcY, zScale + zBias * rhw, 1.0f) * reproject;
+                if (prev.w <= 0.0f) continue;
+                float invW = 1.0f / prev.w;
+                float sx   = (prev.x * invW + 1.0f) * (float)width * 0.5f;
+                float sy   = (1.0f - prev.y * invW) * (float)height * 0.5f;
+                // 上一帧在屏幕外
+                if (!(sx >= 0.0f && sy >= 0.0f && sx < (float)width && sy < (float)height))
+                    continue;
+                int hx = (int)sx, hy = (int)sy;
+                // 上一帧这里是别的表面：新露出来的区域或者被遮挡
+                float prevRhw = rhw * invW;
+                if (Abs(HistoryDepth(hx, hy) - prevRhw) > prevRhw * REPROJECTION_DEPTH_TOLERANCE)
+                    continue;
+
+                if (!touched) {
+                    m_colorBuffer.Touch(tx << 3, tx << 3, ty << 3);
+                    touched = true;
+                }
+                color[i] = m_historyColor.IsTileCleared(hx >> 3, hy >> 3)
+                               ? m_historyColor.ClearValue()
+                               : m_historyColor.At(hx, hy);
+                mask[i]  = 1;
+                reused++;
+            }
+        }
+    }
+    m_reusedFraction = covered ? (float)reused / (float)covered : 1.0f;
+}
+
+// 内部分辨率到窗口的双线性放大，像素中心对齐，坐标用 16.16 定点数
+void Renderer::Upscale() {
+    int srcW = m_renderWidth, srcH = m_renderHeight;
+    int dstW = m_windowWidth, dstH = m_windowHeight;
+    // 每一列的源坐标只和缩放比例有关，逐帧复用
+    if ((int)m_upscaleX.size() != dstW || m_upscaleSourceWidth != srcW) {
+        m_upscaleX.resize(dstW);
+        m_upscaleSourceWidth = srcW;
+        for (int x = 0; x < dstW; x++) {
+            int32_t sx    = (int32_t)(((x + 0.5f) * srcW / dstW - 0.5f) * 65536.0f);
+            m_upscaleX[x] = Between(0, (srcW - 1) << 16, sx);
+        }
+    }
+    for (int y = 0; y < dstH; y++) {
+        int32_t         sy   = (int32_t)(((y + 0.5f) * srcH / dstH - 0.5f) * 65536.0f);
+        sy                   = Between(0, (srcH - 1) << 16, sy);
+        int             y0   = sy >> 16;
+        int             y1   = Min(y0 + 1, srcH - 1);
+        int32_t         dy   = (sy >> 8) & 0xff;
+        const uint32_t* row0 = m_scaledFrame.data() + (size_t)y0 * srcW;
+        const uint32_t* row1 = m_scaledFrame.data() + (size_t)y1 * srcW;
+        uint32_t*       out  = m_frameBuffer + (size_t)y * dstW;
+        for (int x = 0; x < dstW; x++) {
+            int     x0 = m_upscaleX[x] >> 16;
+            int     x1 = Min(x0 + 1, srcW - 1);
+            int32_t dx = (m_upscaleX[x] >> 8) & 0xff;
+            out[x]     = m_kernels.bilinearFilter(row0[x0], row0[x1], row1[x0], row1[x1], dx, dy);
+        }
+    }
+}
+
+void Renderer::SetRenderScale(float scale) {
+    m_renderScale  = Between(m_minRenderScale, 1.0f, scale);
+    m_renderWidth  = Max(1, (int)(m_windowWidth * m_renderScale));
+    m_renderHeight = Max(1, (int)(m_windowHeight * m_renderScale));
+    m_scaledFrame.resize((size_t)m_renderWidth * m_renderHeight);
+}
+
+void Renderer::SetFrameTimeBudget(float milliseconds, float minScale) {
+    m_frameTimeBudget = milliseconds;
+    m_minRenderScale  = Between(0.1f, 1.0f, minScale);
+    SetRenderScale(milliseconds > 0.0f ? m_renderScale : 1.0f);
+}
+
+// 根据上一帧的耗时调整下一帧的内部分辨率
+void Renderer::UpdateRenderScale(float frameMilliseconds) {
+    if (m_frameTimeBudget <= 0.0f) return;
+    // 耗时大致和像素数成正比，边长按耗时比例的平方根调整；每次只走一半，避免来回振荡
+    float target = m_renderScale * sqrtf(m_frameTimeBudget / Max(frameMilliseconds, 0.1f));
+    float scale  = Between(m_minRenderScale, 1.0f, m_renderScale + (target - m_renderScale) * 0.5f);
+    // 变化太小时保持不变，避免分辨率每帧抖动
+    if (Abs(scale - m_renderScale) < 0.02f) return;
+    SetRenderScale(scale);
+}
+
 Renderer::Renderer(const WindowInfo& windowInfo)
     : m_windowWidth(windowInfo.width), m_windowHeight(windowInfo.height) {
     m_window = SDL_CreateWindow(windowInfo.title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
                                 windowInfo.width, windowInfo.height, SDL_WINDOW_RESIZABLE);
     m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+    m_sampleCount = windowInfo.sampleCount;
     Resize(windowInfo.width, windowInfo.height);
+    std::cout << "# kernels: " << m_kernels.name << std::endl;
 }
 
 Renderer::~Renderer() {
@@ -275,28 +1238,58 @@ Renderer::~Renderer() {
 }
 
 void Renderer::DrawPixel(int x, int y, const Vec4f& color) {
-    Vec4f myColorVec = vector_clamp(color, 0.0f, 1.0f);
-    auto  r          = static_cast<int>(myColorVec.r * 255.0f);
-    auto  g          = static_cast<int>(myColorVec.g * 255.0f);
-    auto  b          = static_cast<int>(myColorVec.b * 255.0f);
-    auto  a          = static_cast<int>(myColorVec.a * 255.0f);
-
-    uint32_t finalColor                      = (a << 24) + (r << 16) + (g << 8) + b;
-    *(m_frameBuffer + y * m_windowWidth + x) = finalColor;
+    m_colorBuffer.Touch(x, x, y);
+    m_colorBuffer.At(x, y) = color;
+    if (m_sampleCount > 1) {
+        m_sampleIndex.Touch(x, x, y);
+        m_sampleIndex.At(x, y) = 0;
+    }
 }
 
 void Renderer::RenderClear() {
-    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
-    SDL_RenderClear(m_renderer);
-    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), 0);
+    // 上一帧的结果留作重投影的来源，清除的是上上帧的缓冲
+    if (m_temporalReuse) {
+        std::swap(m_colorBuffer, m_historyColor);
+        std::swap(m_depthBuffer, m_historyDepth);
+        std::swap(m_sampleDepth, m_historySampleDepth);
+        std::swap(m_sampleIndex, m_historySampleIndex);
+    }
+    // 只标记块，不写内存；RenderPresent 会覆盖整个窗口，不需要再清除 SDL 的后台缓冲
+    m_depthBuffer.Clear(0.0f);
+    m_colorBuffer.Clear(Vec4f(0.0f, 0.0f, 0.0f, 0.0f));
+    if (m_sampleCount > 1) {
+        m_sampleDepth.Clear(Vec4f(0.0f, 0.0f, 0.0f, 0.0f));
+        m_sampleIndex.Clear(0);
+        m_samplePool.resize(1);
+    }
 }
 
 void Renderer::Resize(int width, int height) {
+    m_windowWidth  = width;
+    m_windowHeight = height;
     ResizeDepthBuffer(width, height);
     ResizeFrameBuffer(width, height);
+    m_span.Resize(width);
+    SetRenderScale(m_renderScale);
+    SetTemporalReuse(m_temporalReuse);
+    m_tileShadingRate.assign((size_t)m_colorBuffer.TilesX() * m_colorBuffer.TilesY(), 0);
+    SetSampleCount(m_sampleCount);
+}
+
+void Renderer::SpanBuffer::Resize(int width) {
+    mask.resize(width);
+    coverage.resize(width);
+    rhw.resize(width);
+    w0.resize(width);
+    w1.resize(width);
+    w2.resize(width);
+    color.resize(width);
+    sampleIndex.resize(width);
+    blockTag.assign(width, 0);
+    blockColor.resize(width);
 }
 
-void Renderer::ResizeDepthBuffer(int width, int height) { m_depthBuffer.resize(width * height); }
+void Renderer::ResizeDepthBuffer(int width, int height) { m_depthBuffer.Resize(width, height); }
 
 void Renderer::SetVertexShader(VertexShader vertexShader) {
     m_vertexShader = std::move(vertexShader);
@@ -304,8 +1297,23 @@ void Renderer::SetVertexShader(VertexShader vertexShader) {
 
 void Renderer::SetPixelShader(PixelShader pixelShader) { m_pixelShader = std::move(pixelShader); }
 
+void Renderer::SetUniforms(const FrameUniforms* frame, const ObjectUniforms* object) {
+    m_frameUniforms  = frame;
+    m_objectUniforms = object;
+}
+
+Vec4f Renderer::ClipPosition(size_t index) const {
+    return Vec4f(m_clipVertices.x[index], m_clipVertices.y[index], m_clipVertices.z[index],
+                 m_clipVertices.w[index]);
+}
+
+void Renderer::SetExposure(float exposure) { m_exposure = exposure; }
+
+void Renderer::SetToneMapping(ToneMapping toneMapping) { m_toneMapping = toneMapping; }
+
 void Renderer::ResizeFrameBuffer(int width, int height) {
     m_swapTexture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ARGB8888,
                                       SDL_TEXTUREACCESS_STREAMING, width, height);
     m_frameBuffer = new uint32_t[width * height];
+    m_colorBuffer.Resize(width, height);
 }
@@ -3,10 +3,15 @@
 #include <array>
 #include <span>
 #include <unordered_map>
+#include <utility>
 
+#include "kernels/kernels.h"
 #include "other/bitmap.h"
 #include "other/math.h"
 #include "other/scene.h"
+#include "other/shadow_map.h"
+#include "other/tiled_buffer.h"
+#include "pipeline.h"
 #include "shader.h"
 
 class SDL_Renderer;
@@ -19,6 +24,23 @@ struct WindowInfo {
     int         y{0};
     int         width{900};
     int         height{600};
+    int         sampleCount{1}; // 1 或 MSAA_SAMPLES
+};
+
+// 4x MSAA：覆盖和深度按 4 个采样点计算，像素着色器每个像素只执行一次
+constexpr int MSAA_SAMPLES = 4;
+
+// 局部光源按 16x16 的屏幕块剔除
+constexpr int LIGHT_TILE_SHIFT = 4;
+
+// 方向光阴影贴图的边长
+constexpr int SHADOW_MAP_SIZE = 1024;
+
+// 时间复用：这一帧能从上一帧复用多少结果
+enum class FrameReuse {
+    None,      // 完整绘制
+    Present,   // 场景和相机都没变，直接显示上一帧
+    Reproject, // 只有相机变了，先画深度，再把上一帧的颜色重投影过来，只着色失效的像素
 };
 
 class Renderer {
@@ -33,23 +55,164 @@ public:
     void ResizeFrameBuffer(int width, int height);
     void SetVertexShader(VertexShader vertexShader);
     void SetPixelShader(PixelShader pixelShader);
+    // 着色器参数块，之后的绘制通过 ShaderContext::frame / object 读取；指针由调用者保持有效
+    void SetUniforms(const FrameUniforms* frame, const ObjectUniforms* object);
+    void SetPipelineState(const PipelineState& state);
+    void SetExposure(float exposure);
+    void SetToneMapping(ToneMapping toneMapping);
+    void SetSampleCount(int sampleCount);
+    // 屏幕上 8x8 块的着色率；开启自适应后每帧根据上一帧的亮度梯度重新设置
+    void SetTileShadingRate(int tileX, int tileY, ShadingRate rate);
+    void SetAdaptiveShading(bool enable, float threshold = 0.08f);
+    // 动态分辨率：每帧根据耗时在 [minScale, 1] 之间调整内部分辨率，放大到窗口显示；budget <= 0 时关闭
+    void SetFrameTimeBudget(float milliseconds, float minScale = 0.5f);
+    void SetRenderScale(float scale);
+    // 开启后每帧先调用 BeginFrame，按返回值决定是否绘制；sceneSignature 覆盖相机以外的所有场景状态
+    void       SetTemporalReuse(bool enable);
+    FrameReuse BeginFrame(uint64_t sceneSignature, const Mat4x4f& matView, const Mat4x4f& matProj);
+    // Reproject 时在深度预绘制之后调用，填充可复用像素的颜色
+    void       ReprojectHistory();
+    // 不重新解析，直接显示上一帧
+    void       PresentPrevious();
+    // 每帧绘制前调用：把局部光源的包围球投影到屏幕，记录每个屏幕块受哪些光源影响
+    void       CullLights(std::span<const LocalLight> lights, const Mat4x4f& matView,
+                          const Mat4x4f& matProj);
+    // 像素着色器中使用：fragCoord 所在块的光源编号（LocalLights 的下标）
+    std::span<const uint32_t>   TileLights(const Vec2i& fragCoord) const;
+    std::span<const LocalLight> LocalLights() const { return m_localLights; }
+    // 从 lightDir 方向用正交投影包住所有 casters，只写深度；signature 和上次相同时直接返回 false
+    bool RenderShadowMap(ShadowMap& shadowMap, const Vec3f& lightDir,
+                         std::span<const SceneNode* const> casters, uint64_t signature);
     Renderer() = delete;
     explicit Renderer(const WindowInfo& windowInfo);
     ~Renderer();
     Renderer& operator=(const Renderer& other) = delete;
     Renderer(const Renderer& other) = delete;
 private:
-    ShaderContext BarycentricInterplate(std::span<Vertex, 3> vertices, const Vec3f& barycentric);
+    void          BarycentricInterplate(std::span<Vertex, 3> vertices, const Vec3f& barycentric,
+                                        ShaderContext& output);
+    // 三角形建立阶段的结果，交给光栅化循环
+    struct TriangleSetup {
+        Vec2i   p[3];
+        int32_t step[3];
+        int32_t bias[3];
+        int     minX, maxX, minY, maxY;
+    };
+    // 8x8 块存储的深度 / HDR 颜色缓冲
+    using DepthBuffer  = TiledBuffer<float>;
+    using ColorBuffer  = TiledBuffer<Vec4f>;
+    using SampleColors = std::array<Vec4f, MSAA_SAMPLES>; // 一个像素的全部采样颜色
+    using Rasterizer   = void (Renderer::*)(std::span<Vertex, 3>, const TriangleSetup&);
+
+    template <uint32_t Key>
+    void RasterizeTriangle(std::span<Vertex, 3> vertices, const TriangleSetup& setup);
+    template <uint32_t Key>
+    void RasterizeTriangleMsaa(std::span<Vertex, 3> vertices, const TriangleSetup& setup);
+    template <size_t... Keys>
+    static constexpr std::array<Rasterizer, sizeof...(Keys) * 2>
+                  MakeRasterizers(std::index_sequence<Keys...>);
+    Vec4f         ShadePixel(std::span<Vertex, 3> vertices, int x, int y, const Vec3f& barycentric,
+                             ShaderContext& input);
+    void          UpdateAdaptiveShadingRates(const uint32_t* pixels);
+    void          UpdateRenderScale(float frameMilliseconds);
+    void          Upscale();
+    void          ResizeHistory();
+    float         HistoryDepth(int x, int y) const;
+    void          UpdateCoarseShading();
+    uint32_t      SelectLod(const SceneNode& node, const Camera& camera) const;
+    // m_clipVertices 中第 index 个批量变换好的裁剪坐标
+    Vec4f         ClipPosition(size_t index) const;
+    // 阴影贴图用的光栅化：v 是屏幕坐标和深度，只做深度测试和写入
+    void          RasterizeShadowTriangle(DepthBuffer& depth, Vec3f (&v)[3]);
+
+    // 光栅化一行像素时的临时数据，长度等于窗口宽度
+    struct SpanBuffer {
+        std::vector<uint8_t>  mask;
+        std::vector<uint8_t>  coverage; // MSAA 每个像素的采样覆盖位
+        std::vector<float>    rhw;
+        std::vector<float>    w0;
+        std::vector<float>    w1;
+        std::vector<float>    w2;
+        std::vector<Vec4f>    color;       // 解析时还原出的一行颜色
+        std::vector<uint32_t> sampleIndex; // 解析时还原出的一行采样索引
+        std::vector<uint64_t> blockTag;    // 粗粒度着色：blockColor 属于哪个三角形的哪个块
+        std::vector<Vec4f>    blockColor;
+        void                  Resize(int width);
+    };
 
 private:
     // 只是用来管理窗口的运行环境
-    int                m_windowWidth{900};
-    int                m_windowHeight{600};
-    SDL_Renderer*      m_renderer{nullptr};
-    SDL_Window*        m_window{nullptr};
-    SDL_Texture*       m_swapTexture{nullptr};
-    uint32_t*          m_frameBuffer;
-    std::vector<float> m_depthBuffer;
-    VertexShader       m_vertexShader;
-    PixelShader        m_pixelShader;
+    int                   m_windowWidth{900};
+    int                   m_windowHeight{600};
+    SDL_Renderer*         m_renderer{nullptr};
+    SDL_Window*           m_window{nullptr};
+    SDL_Texture*          m_swapTexture{nullptr};
+    uint32_t*             m_frameBuffer;
+    ColorBuffer           m_colorBuffer; // HDR 颜色，RenderPresent 时解析到 m_frameBuffer
+    DepthBuffer           m_depthBuffer;
+    VertexShader          m_vertexShader;
+    PixelShader           m_pixelShader;
+    const FrameUniforms*  m_frameUniforms{nullptr};
+    const ObjectUniforms* m_objectUniforms{nullptr};
+    ClipSoA               m_clipVertices; // 当前模型批量变换后的裁剪空间顶点
+    SpanBuffer            m_span;
+    PipelineState         m_pipelineState;
+    Rasterizer            m_rasterizer{nullptr};
+    float                 m_exposure{1.0f};
+    ToneMapping           m_toneMapping{ToneMapping::Linear};
+    const KernelTable&    m_kernels{GetKernels()}; // 启动时按 CPU 特性选定的内核
+
+    // MSAA 的存储：每个像素 4 个采样深度，颜色默认只在 m_colorBuffer 中存一份
+    // 只有边缘上被部分覆盖的像素才在 m_samplePool 中分配 4 个采样颜色，m_sampleIndex 为 0 表示未分配
+    int                       m_sampleCount{1};
+    ColorBuffer               m_sampleDepth;
+    TiledBuffer<uint32_t>     m_sampleIndex;
+    std::vector<SampleColors> m_samplePool;
+
+    // 可变着色率
+    std::vector<uint8_t> m_tileShadingRate; // 每个 8x8 块的 ShadingRate
+    bool                 m_adaptiveShading{false};
+    float                m_adaptiveThreshold{0.08f};
+    bool                 m_coarseShading{false}; // 当前是否有非 1x1 的着色率
+    uint32_t             m_drawId{0};            // 每个三角形递增，区分粗粒度着色的缓存
+
+    // 动态分辨率：光栅化只使用缓冲左上角 m_renderWidth x m_renderHeight 的区域
+    int                   m_renderWidth{900};
+    int                   m_renderHeight{600};
+    float                 m_renderScale{1.0f};
+    float                 m_minRenderScale{0.5f};
+    float                 m_frameTimeBudget{0.0f}; // 毫秒
+    std::vector<uint32_t> m_scaledFrame;           // 内部分辨率下解析后的颜色
+    std::vector<int32_t>  m_upscaleX;              // 放大时每一列的源坐标（16.16）
+    int                   m_upscaleSourceWidth{0};
+
+    // 时间复用：上一帧的颜色和深度缓冲，RenderClear 时和当前帧的缓冲交换，不需要拷贝
+    bool                  m_temporalReuse{false};
+    bool                  m_historyValid{false};
+    bool                  m_reprojecting{false}; // 本帧跳过 m_reuseMask 标记的像素
+    uint64_t              m_frameSignature{0};
+    uint64_t              m_historySignature{0};
+    Mat4x4f               m_frameViewProj;
+    Mat4x4f               m_frameProj;
+    Mat4x4f               m_historyViewProj;
+    ColorBuffer           m_historyColor;
+    DepthBuffer           m_historyDepth;
+    ColorBuffer           m_historySampleDepth;
+    TiledBuffer<uint32_t> m_historySampleIndex; // 上一帧展开过的像素不参与复用
+    TiledBuffer<uint8_t>  m_reuseMask;
+    float                 m_reusedFraction{1.0f}; // 上一次重投影复用的像素比例
+    uint32_t              m_frameIndex{0};
+
+    // 分块光源剔除：第 t 块的光源编号是
+    // m_lightTileIndices[m_lightTileOffsets[t], m_lightTileOffsets[t + 1])
+    std::vector<LocalLight>         m_localLights;
+    std::vector<std::array<int, 4>> m_lightTileRects; // 每个光源覆盖的块范围 x0, y0, x1, y1
+    std::vector<uint32_t>           m_lightTileOffsets;
+    std::vector<uint32_t>           m_lightTileIndices;
+    std::vector<uint32_t>           m_lightTileCursor; // 填充索引时每块的写入位置
+    int                             m_lightTilesX{0};
+    int                             m_lightTilesY{0};
+
+    // 每个投射阴影的方向光一张阴影贴图
+    std::unordered_map<const BasicLight*, ShadowMap> m_shadowMaps;
 };
\ No newline at end of file
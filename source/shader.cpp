@@ -1,8 +1,8 @@
 #include "shader.h"
 
 void ShaderContext::Clear() {
-    varyingFloat.clear();
-    varyingVec2f.clear();
-    varyingVec3f.clear();
-    varyingVec4f.clear();
+    varyingFloat.Clear();
+    varyingVec2f.Clear();
+    varyingVec3f.Clear();
+    varyingVec4f.Clear();
 }
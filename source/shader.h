@@ -1,22 +1,78 @@
 #pragma once
 
+#include <array>
+#include <bit>
+#include <cstdint>
 #include <functional>
-#include <unordered_map>
 
 #include "other/math.h"
 
+class Model;
+class ShadowMap;
+
+// 每种类型最多的 varying 个数
+constexpr int MAX_VARYINGS = 8;
+
+// 按编号存放的 varying，used 记录写过的编号
+// 数据是连续的 float，插值时整段交给 KernelTable::interpolate
+template <typename T> struct VaryingSlots {
+    std::array<T, MAX_VARYINGS> values{};
+    uint32_t                    used{0};
+
+    T& operator[](int key) {
+        used |= 1u << key;
+        return values[key];
+    }
+    const T& operator[](int key) const { return values[key]; }
+    // 最大的已用编号 + 1
+    int      End() const { return 32 - std::countl_zero(used); }
+    void     Clear() {
+        for (int i = 0; i < End(); i++)
+            values[i] = T();
+        used = 0;
+    }
+};
+
+// 一帧之内不变的着色器参数；光照部分每个光源 pass 更新一次
+struct FrameUniforms {
+    Mat4x4f          view;
+    Mat4x4f          proj;
+    Mat4x4f          viewProj;
+    Vec3f            eyePos;
+    bool             hasLight{false}; // 没有方向光的 pass 只有环境光和局部光源
+    Vec3f            lightDir;        // 指向光源，已归一化
+    Vec3f            lightColor;
+    const ShadowMap* shadowMap{nullptr};
+    float            ambient{0.0f};
+    bool             localLights{false}; // 是否累加分块剔除后的局部光源
+};
+
+// 每个绘制实例的着色器参数
+struct ObjectUniforms {
+    const Model* model{nullptr};
+    Mat4x4f      world;
+    Mat3x3f      normal;
+    Vec4f        color;
+    size_t       clipOffset{0}; // 批量变换的裁剪坐标中这个实例的起点
+};
+
+// frame / object 由 Renderer::SetUniforms 设置，顶点和像素着色器通过它们读取参数
 struct ShaderContext {
-    std::unordered_map<int, float> varyingFloat; // 浮点数 varying 列表
-    std::unordered_map<int, Vec2f> varyingVec2f; // 二维矢量 varying 列表
-    std::unordered_map<int, Vec3f> varyingVec3f; // 三维矢量 varying 列表
-    std::unordered_map<int, Vec4f> varyingVec4f; // 四维矢量 varying 列表
-    void                           Clear();
+    VaryingSlots<float>   varyingFloat; // 浮点数 varying 列表
+    VaryingSlots<Vec2f>   varyingVec2f; // 二维矢量 varying 列表
+    VaryingSlots<Vec3f>   varyingVec3f; // 三维矢量 varying 列表
+    VaryingSlots<Vec4f>   varyingVec4f; // 四维矢量 varying 列表
+    Vec2i                 fragCoord;    // 像素着色器所在的像素（内部分辨率）
+    const FrameUniforms*  frame{nullptr};
+    const ObjectUniforms* object{nullptr};
+    void                  Clear();
 };
 
 struct VertexAttrib {
-    Vec3f pos;
-    Vec3f normal;
-    Vec2f uv;
+    Vec3f    pos;
+    Vec3f    normal;
+    Vec2f    uv;
+    uint32_t index{0}; // 在网格顶点数组中的编号，用来读取批量变换好的裁剪坐标
 };
 
 struct Vertex {